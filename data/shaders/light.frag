@@ -10,6 +10,14 @@ uniform sampler2D tex1;
 
 out vec4 color;
 
+// color textures are sampled as linear values, the default framebuffer is
+// not sRGB so encode on the way out
+vec3 LinearToSrgb(vec3 c) {
+    return mix(c * 12.92, 1.055 * pow(c, vec3(1.0 / 2.4)) - 0.055,
+               step(vec3(0.0031308), c));
+}
+
 void main() {
-    color = texture(tex0, texcoord0);
+    vec4 base = texture(tex0, texcoord0);
+    color = vec4(LinearToSrgb(base.rgb), base.a);
 }
@@ -1,21 +1,64 @@
 #version 430 core
 layout(location = 0) in vec3 in_vertex;
+#ifdef QUANTIZED
+// octahedral
+layout(location = 1) in vec2 in_normal;
+#else
 layout(location = 1) in vec3 in_normal;
+#endif
 layout(location = 3) in vec2 in_texcoord0;
 layout(location = 4) in vec2 in_texcoord1;
 
-uniform mat4 MVP;
+layout(std140, binding = 0) uniform Camera {
+    mat4 view;
+    mat4 projection;
+    mat4 viewProj;
+    vec4 clipPlane;
+};
+
+#ifdef QUANTIZED
+// pdx::Dequantization of the mesh being drawn, the vertex fetch already
+// turned the snorm16 and unorm16 attributes into floats
+layout(std140, binding = 2) uniform Mesh {
+    vec4 positionScale;
+    vec4 positionOffset;
+    vec4 texcoordTransform[2];
+};
+#endif
+
+uniform mat4 model;
 
 out vec3 normal;
 out vec3 position;
 out vec2 texcoord0;
 out vec2 texcoord1;
 
+#ifdef QUANTIZED
+vec3 OctDecode(vec2 e) {
+    vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    if (n.z < 0.0) {
+        n.xy = (1.0 - abs(n.yx)) * vec2(n.x >= 0.0 ? 1.0 : -1.0,
+                                        n.y >= 0.0 ? 1.0 : -1.0);
+    }
+    return normalize(n);
+}
+#endif
+
 void main() {
-    gl_Position = MVP * vec4(in_vertex, 1.0);
-    position = gl_Position.xyz;
-    normal = normalize(mat3(MVP) * in_normal);
-    position = in_vertex;
+#ifdef QUANTIZED
+    vec3 vertex = in_vertex * positionScale.xyz + positionOffset.xyz;
+    vec3 objectNormal = OctDecode(in_normal);
+    texcoord0 = in_texcoord0 * texcoordTransform[0].xy +
+                texcoordTransform[0].zw;
+    texcoord1 = in_texcoord1 * texcoordTransform[1].xy +
+                texcoordTransform[1].zw;
+#else
+    vec3 vertex = in_vertex;
+    vec3 objectNormal = in_normal;
     texcoord0 = in_texcoord0;
     texcoord1 = in_texcoord1;
+#endif
+    gl_Position = viewProj * model * vec4(vertex, 1.0);
+    normal = normalize(mat3(model) * objectNormal);
+    position = vertex;
 }
@@ -0,0 +1,17 @@
+#version 430 core
+out vec4 FragColor;
+
+in vec4 surfacePosition;
+
+uniform sampler2D portalView;
+
+void main() {
+    // behind the view the image was drawn for, nothing of it is visible
+    if (surfacePosition.w <= 0.0) {
+        FragColor = vec4(0.1, 0.1, 0.1, 1.0);
+        return;
+    }
+    // the image is already encoded for the default framebuffer
+    vec2 uv = surfacePosition.xy / surfacePosition.w * 0.5 + 0.5;
+    FragColor = vec4(texture(portalView, uv).rgb, 1.0);
+}
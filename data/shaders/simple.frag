@@ -5,6 +5,14 @@ in vec2 TexCoord;
 
 uniform sampler2D texture1;
 
+// color textures are sampled as linear values, the default framebuffer is
+// not sRGB so encode on the way out
+vec3 LinearToSrgb(vec3 c) {
+    return mix(c * 12.92, 1.055 * pow(c, vec3(1.0 / 2.4)) - 0.055,
+               step(vec3(0.0031308), c));
+}
+
 void main() {
-    FragColor = texture(texture1, TexCoord);
+    vec4 color = texture(texture1, TexCoord);
+    FragColor = vec4(LinearToSrgb(color.rgb), color.a);
 }
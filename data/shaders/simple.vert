@@ -4,11 +4,48 @@ layout(location = 3) in vec2 texCoord;
 
 out vec2 TexCoord;
 
+layout(std140, binding = 0) uniform Camera {
+    mat4 view;
+    mat4 projection;
+    mat4 viewProj;
+    vec4 clipPlane;
+};
+
+#ifdef QUANTIZED
+// pdx::Dequantization of the mesh being drawn, the vertex fetch already
+// turned the snorm16 and unorm16 attributes into floats
+layout(std140, binding = 2) uniform Mesh {
+    vec4 positionScale;
+    vec4 positionOffset;
+    vec4 texcoordTransform[2];
+};
+#endif
+
+#ifdef MULTI_DRAW
+// one transform per draw, selected through the draw's baseInstance
+layout(location = 5) in uint in_drawId;
+
+layout(std430, binding = 1) readonly buffer Draws {
+    mat4 transforms[];
+};
+#elif defined(INSTANCED)
+layout(location = 6) in mat4 in_instance;
+#else
 uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+#endif
 
 void main() {
-    gl_Position = projection * view * model * vec4(pos, 1.0);
-    TexCoord = vec2(texCoord);
+#ifdef MULTI_DRAW
+    mat4 model = transforms[in_drawId];
+#elif defined(INSTANCED)
+    mat4 model = in_instance;
+#endif
+    vec3 position = pos;
+    vec2 uv = texCoord;
+#ifdef QUANTIZED
+    position = position * positionScale.xyz + positionOffset.xyz;
+    uv = uv * texcoordTransform[0].xy + texcoordTransform[0].zw;
+#endif
+    gl_Position = viewProj * model * vec4(position, 1.0);
+    TexCoord = uv;
 }
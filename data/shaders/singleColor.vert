@@ -1,10 +1,45 @@
 #version 430 core
 layout(location = 0) in vec3 pos;
 
+layout(std140, binding = 0) uniform Camera {
+    mat4 view;
+    mat4 projection;
+    mat4 viewProj;
+    vec4 clipPlane;
+};
+
+#ifdef QUANTIZED
+// pdx::Dequantization of the mesh being drawn, the vertex fetch already
+// turned the snorm16 and unorm16 attributes into floats
+layout(std140, binding = 2) uniform Mesh {
+    vec4 positionScale;
+    vec4 positionOffset;
+    vec4 texcoordTransform[2];
+};
+#endif
+
+#ifdef INSTANCED
+layout(location = 6) in mat4 in_instance;
+#else
 uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+#endif
+
+#ifdef PORTAL_VIEW
+// view projection of the view the portal image is seen from
+uniform mat4 surfaceViewProj;
+out vec4 surfacePosition;
+#endif
 
 void main() {
-    gl_Position = projection * view * model * vec4(pos, 1.0);
+#ifdef INSTANCED
+    mat4 model = in_instance;
+#endif
+    vec3 position = pos;
+#ifdef QUANTIZED
+    position = position * positionScale.xyz + positionOffset.xyz;
+#endif
+    gl_Position = viewProj * model * vec4(position, 1.0);
+#ifdef PORTAL_VIEW
+    surfacePosition = surfaceViewProj * model * vec4(position, 1.0);
+#endif
 }
@@ -0,0 +1,167 @@
+#ifndef __HPP_PARADOX_ASSETLOADER__
+#define __HPP_PARADOX_ASSETLOADER__
+
+#include <glad/gl.h>
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <filesystem>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "meshasset.hpp"
+#include "model.hpp"
+#include "types.hpp"
+
+namespace pdx {
+struct ResidencyStats {
+  // models and assets in flight, and their geometry plus unique textures
+  size_t cpuBytes;
+  size_t gpuBytes;
+  size_t cpuBudget;
+  size_t gpuBudget;
+  uint32_t resident;
+  uint32_t evicted;
+  // totals since the loader was created
+  uint32_t evictions;
+  uint32_t reloads;
+  uint32_t evictionsThisFrame;
+};
+
+// Loads models in the background. File I/O, glTF parsing and image decoding
+// run on worker threads, the finished assets are uploaded on the render thread
+// by Poll, a few steps per frame. Load hands out a model_handle_t straight
+// away, Get resolves it to nullptr until the model is completely uploaded.
+//
+// Uploaded models are kept within a CPU and a GPU budget. Every Get counts as
+// a use in the current frame, so models recorded for any view, portal views
+// included, stay resident. When a budget is exceeded the least recently used
+// models are evicted, and the next Get of an evicted handle queues a reload
+// on the workers
+class AssetLoader {
+public:
+  AssetLoader() = default;
+  AssetLoader(const AssetLoader&) = delete;
+  ~AssetLoader();
+
+  auto operator=(const AssetLoader&) -> AssetLoader& = delete;
+
+  // store vertices as pdx::QuantizedVertex, shaders then need the QUANTIZED
+  // define. Has to be set before the first Load
+  auto SetQuantize(bool quantize) -> void;
+  auto Quantize() const -> bool;
+  // run the mesh optimizer on models that are not cooked, has to be set
+  // before the first Load
+  auto SetOptimize(bool optimize) -> void;
+  // SIZE_MAX disables a budget
+  auto SetBudget(size_t cpuBytes, size_t gpuBytes) -> void;
+
+  // the same file is only ever loaded once
+  auto Load(const std::filesystem::path& file) -> pdx::model_handle_t;
+  // marks the model as used this frame. The pointer stays valid until the
+  // model is evicted, which needs it unused for MIN_IDLE_FRAMES polls
+  auto Get(pdx::model_handle_t handle) const -> const pdx::Model *;
+  // like Get, but neither marks a use nor asks for a reload, for tools and
+  // statistics that must not keep models resident
+  auto Peek(pdx::model_handle_t handle) const -> const pdx::Model *;
+  auto Failed(pdx::model_handle_t handle) const -> bool;
+  // handles run from 0 to Size() - 1
+  auto File(pdx::model_handle_t handle) const -> const std::filesystem::path&;
+
+  // starts a new frame: queues reloads of evicted models that were asked
+  // for, uploads finished loads until budgetBytes have been copied, at least
+  // one upload step is always made so large assets still progress, and
+  // evicts models while over budget
+  auto Poll(size_t budgetBytes = DEFAULT_UPLOAD_BUDGET) -> void;
+
+  // stops the workers and releases every model and the staging buffer, must
+  // be called while the GL context is current
+  auto Shutdown() -> void;
+
+  auto Size() const -> size_t;
+  auto Pending() const -> size_t;
+  auto UploadedThisFrame() const -> size_t;
+  // vertex memory saved by quantization over every uploaded model
+  auto QuantizationSavedBytes() const -> size_t;
+  auto Residency() const -> pdx::ResidencyStats;
+
+  static constexpr size_t DEFAULT_UPLOAD_BUDGET = 8 * 1024 * 1024;
+  // polls a model has to go unused before it may be evicted
+  static constexpr uint64_t MIN_IDLE_FRAMES = 2;
+
+private:
+  enum class State { LOADING, READY, FAILED, EVICTED };
+
+  struct Entry {
+    std::filesystem::path file;
+    State state = State::LOADING;
+    std::optional<pdx::Model> model;
+    // written by Get
+    mutable uint64_t lastUsed = 0;
+    mutable bool requested = false;
+  };
+
+  struct Job {
+    pdx::model_handle_t handle;
+    std::filesystem::path file;
+  };
+
+  struct Finished {
+    pdx::model_handle_t handle;
+    std::optional<pdx::MeshAsset> asset;
+  };
+
+  // an asset that is partially on the GPU
+  struct Upload {
+    pdx::model_handle_t handle;
+    pdx::MeshAsset asset;
+    std::optional<pdx::Model> model;
+    size_t nextTexture = 0;
+  };
+
+  auto Start() -> void;
+  auto StopWorkers() -> void;
+  auto Worker() -> void;
+  // uploads the geometry or the next texture, returns the bytes copied
+  auto Step(Upload& upload) -> size_t;
+  auto NextStepSize(const Upload& upload) const -> size_t;
+  auto UploadTexture(const pdx::MeshTexture& texture) -> GLuint;
+  auto Queue(pdx::model_handle_t handle) -> void;
+  // recounts m_CpuBytes and m_GpuBytes
+  auto Measure() -> void;
+  auto EnforceBudget() -> void;
+
+  std::deque<Entry> m_Entries;
+  std::unordered_map<std::string, pdx::model_handle_t> m_Handles;
+  std::deque<Upload> m_Uploads;
+
+  std::vector<std::thread> m_Workers;
+  mutable std::mutex m_Mutex;
+  std::condition_variable m_Wake;
+  std::deque<Job> m_Jobs;
+  std::deque<Finished> m_Finished;
+  bool m_Stop = false;
+  bool m_Quantize = false;
+  bool m_Optimize = false;
+
+  GLuint m_Staging = 0;
+  size_t m_UploadedThisFrame = 0;
+  size_t m_QuantizationSaved = 0;
+
+  uint64_t m_Frame = 0;
+  size_t m_CpuBudget = SIZE_MAX;
+  size_t m_GpuBudget = SIZE_MAX;
+  size_t m_CpuBytes = 0;
+  size_t m_GpuBytes = 0;
+  uint32_t m_Evictions = 0;
+  uint32_t m_Reloads = 0;
+  uint32_t m_EvictionsThisFrame = 0;
+};
+} // namespace pdx
+
+#endif /*  __HPP_PARADOX_ASSETLOADER__ */
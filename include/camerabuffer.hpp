@@ -0,0 +1,53 @@
+#ifndef __HPP_PARADOX_CAMERABUFFER__
+#define __HPP_PARADOX_CAMERABUFFER__
+
+#include <glad/gl.h>
+#include <glm/glm.hpp>
+
+#include "types.hpp"
+
+namespace pdx {
+// binding point of the Camera uniform block used by every vertex shader
+constexpr GLuint CAMERA_BLOCK_BINDING = 0;
+
+// mirrors the std140 Camera block in data/shaders/*.vert
+struct CameraBlock {
+  glm::mat4 view;
+  glm::mat4 projection;
+  glm::mat4 viewProj;
+  glm::vec4 clipPlane;
+};
+
+// Uniform buffer holding one CameraBlock per view rendered this frame. Every
+// view is written once and afterwards only rebound, so parent views can be
+// restored after recursing into a portal without uploading them again
+class CameraBuffer {
+public:
+  CameraBuffer() = default;
+  CameraBuffer(const CameraBuffer&) = delete;
+
+  auto operator=(const CameraBuffer&) -> CameraBuffer& = delete;
+
+  auto Create(uint32_t capacity = 64) -> void;
+  auto Destroy() -> void;
+
+  auto BeginFrame() -> void;
+  // writes a new view and binds it, the returned slot is valid until the next
+  // BeginFrame
+  auto Push(const glm::mat4& view, const glm::mat4& projection,
+            const glm::vec4& clipPlane) -> uint32_t;
+  auto Bind(uint32_t slot) const -> void;
+
+  auto ViewsThisFrame() const -> uint32_t;
+
+private:
+  auto Grow() -> void;
+
+  pdx::ubo_t m_Buffer = 0;
+  GLsizeiptr m_Stride = 0;
+  uint32_t m_Capacity = 0;
+  uint32_t m_Count = 0;
+};
+} // namespace pdx
+
+#endif /*  __HPP_PARADOX_CAMERABUFFER__ */
@@ -0,0 +1,106 @@
+#ifndef __HPP_PARADOX_DRAWLIST__
+#define __HPP_PARADOX_DRAWLIST__
+
+#include <glad/gl.h>
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <vector>
+
+#include "model.hpp"
+#include "shader.hpp"
+#include "types.hpp"
+
+namespace pdx {
+// binding point of the Draws storage block in data/shaders/*.vert
+constexpr GLuint DRAW_TRANSFORM_BINDING = 1;
+
+// layout read by glMultiDrawElementsIndirect
+struct DrawElementsIndirectCommand {
+  uint32_t count;
+  uint32_t instanceCount;
+  uint32_t firstIndex;
+  int32_t baseVertex;
+  uint32_t baseInstance;
+};
+
+// Static draws recorded once per frame and submitted for every view. Draws
+// of the same model and primitive mode become one glMultiDrawElementsIndirect
+// call, each command's baseInstance selects its transform from a storage
+// buffer. Without multi draw support the draws are issued one by one. Every
+// Submit picks each packet's LOD for its view, the command buffer is only
+// rewritten when a level changed
+class DrawList {
+public:
+  DrawList() = default;
+  DrawList(const DrawList&) = delete;
+
+  auto operator=(const DrawList&) -> DrawList& = delete;
+
+  auto Destroy() -> void;
+
+  // also ends the frame the triangle counters report on
+  auto Clear() -> void;
+  // node -1 draws the whole model, the model has to outlive the frame
+  auto Add(const pdx::Model& model, const glm::mat4& transform, int node = -1)
+      -> void;
+  // writes the transform buffer and batches the commands, call after the
+  // last Add
+  auto Upload() -> void;
+
+  // multiDraw is the MULTI_DRAW variant of single. multiDrawReady tells
+  // whether it can be used yet, until then single draws every item
+  auto Submit(const pdx::Shader& multiDraw, bool multiDrawReady,
+              const pdx::Shader& single, const pdx::LodView& lod) -> void;
+
+  auto Draws() const -> size_t;
+  // draw calls per Submit
+  auto Calls() const -> size_t;
+  // triangles submitted over every view of the previous frame, and how many
+  // they would have been at full detail
+  auto Triangles() const -> size_t;
+  auto FullDetailTriangles() const -> size_t;
+  // whether the draws or their transforms differ from the previous frame's,
+  // valid after Upload
+  auto Changed() const -> bool;
+
+private:
+  struct Item {
+    const pdx::Model *model;
+    int node;
+
+    auto operator==(const Item&) const -> bool = default;
+  };
+
+  // commands [first, first + count) share a model and primitive mode
+  struct Batch {
+    const pdx::Model *model;
+    GLenum mode;
+    uint32_t first;
+    uint32_t count;
+  };
+
+  auto UseMultiDraw() const -> bool;
+
+  std::vector<Item> m_Items;
+  // indexed by item and command baseInstance
+  std::vector<glm::mat4> m_Transforms;
+  // the previous frame's, kept for Changed
+  std::vector<Item> m_PreviousItems;
+  std::vector<glm::mat4> m_PreviousTransforms;
+  bool m_Changed = true;
+  std::vector<pdx::DrawElementsIndirectCommand> m_Commands;
+  // packet and LOD level in the uploaded buffer of every command
+  std::vector<const pdx::DrawPacket *> m_CommandPackets;
+  std::vector<uint32_t> m_CommandLevels;
+  std::vector<Batch> m_Batches;
+  GLuint m_CommandBuffer = 0;
+  GLuint m_TransformBuffer = 0;
+  size_t m_Triangles = 0;
+  size_t m_FullDetailTriangles = 0;
+  size_t m_LastTriangles = 0;
+  size_t m_LastFullDetailTriangles = 0;
+};
+} // namespace pdx
+
+#endif /*  __HPP_PARADOX_DRAWLIST__ */
@@ -1,14 +1,21 @@
 #ifndef __HPP_PARADOX_GAME__
 #define __HPP_PARADOX_GAME__
 
+#include "assetloader.hpp"
 #include "camera.hpp"
+#include "camerabuffer.hpp"
+#include "drawlist.hpp"
 #include "model.hpp"
+#include "portalbudget.hpp"
+#include "portaltargets.hpp"
 #include "portal.hpp"
+#include "shadercache.hpp"
 #include <glad/gl.h>
 
 #include <SDL2/SDL.h>
 #include <SDL2/SDL_opengl.h>
 
+#include <span>
 #include <string>
 #include <vector>
 
@@ -20,12 +27,49 @@ public:
   auto Run() -> void;
 
 private:
+  // screenRect is the NDC rectangle (min x, min y, max x, max y) of the
+  // portal this view is seen through, portals outside it are skipped
   auto DrawPortals(const glm::mat4& view, const glm::mat4& proj,
-                   uint32_t recursionLevel) const -> void;
-  auto DrawLevel(const glm::mat4& view, const glm::mat4& proj) const -> void;
+                   const glm::vec4& clipPlane, uint32_t recursionLevel,
+                   const glm::vec4& screenRect) -> void;
+  // render-to-texture mode, redraws the portal images that are out of date
+  // and then the view itself with the portal planes showing them
+  auto DrawPortalTargets(const glm::mat4& view, const glm::mat4& projection)
+      -> void;
+  // planes of portals, showing their images where there is one
+  auto DrawPortalViews(std::span<const uint32_t> portals) -> void;
+  // records the level's static draws, once per frame before any view
+  auto BuildLevel() -> void;
+  // limits rasterization and clears to an NDC rectangle
+  auto Scissor(const glm::vec4& rect) -> void;
+  // LOD selection for a view seen through recursionLevel portals
+  auto LevelLod(const glm::mat4& view, const glm::mat4& projection,
+                uint32_t recursionLevel) const -> pdx::LodView;
+  // draws with the view that is currently bound in m_CameraBuffer
+  auto DrawLevel(const pdx::LodView& lod) -> void;
 
   std::vector<pdx::Portal> m_Portals;
-  std::vector<pdx::Model> m_Models;
+  pdx::AssetLoader m_Assets;
+  pdx::model_handle_t m_Floor;
+  pdx::model_handle_t m_Cube;
+  pdx::DrawList m_LevelDraws;
+  pdx::PortalBudget m_PortalBudget;
+  pdx::PortalTargets m_PortalTargets;
+  bool m_UsePortalTargets = false;
+
+  pdx::ShaderCache m_Shaders;
+  pdx::CameraBuffer m_CameraBuffer;
+  pdx::shader_handle_t m_SimpleShader;
+  pdx::shader_handle_t m_SimpleMultiDrawShader;
+  pdx::shader_handle_t m_SingleColorShader;
+  pdx::shader_handle_t m_SingleColorInstancedShader;
+  pdx::shader_handle_t m_PortalViewShader;
+
+  // portal views drawn and skipped by culling, counted per frame
+  uint32_t m_PortalViews = 0;
+  uint32_t m_CulledPortalViews = 0;
+  // scissored area of the drawn portal views, in screens
+  float m_PortalViewArea = 0.0f;
 
   int m_WindowWidth, m_WindowHeight;
   SDL_Window *m_Window;
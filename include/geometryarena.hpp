@@ -0,0 +1,128 @@
+#ifndef __HPP_PARADOX_GEOMETRYARENA__
+#define __HPP_PARADOX_GEOMETRYARENA__
+
+#include <glad/gl.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <vector>
+
+#include "meshdata.hpp"
+#include "rangeallocator.hpp"
+#include "types.hpp"
+
+namespace pdx {
+enum class VertexFormat : uint32_t {
+  // pdx::Vertex, all float
+  STANDARD,
+  // pdx::QuantizedVertex, shaders need the QUANTIZED define
+  QUANTIZED,
+  COUNT
+};
+
+// binding point of the Mesh uniform block holding a quantized mesh's
+// pdx::Dequantization
+constexpr GLuint MESH_BLOCK_BINDING = 2;
+
+// A model's slice of the arena. Packets add firstVertex to their base vertex
+// and firstIndex to their first index
+struct GeometryRange {
+  pdx::VertexFormat format;
+  uint32_t page;
+  uint32_t firstVertex;
+  uint32_t vertexCount;
+  uint32_t firstIndex;
+  uint32_t indexCount;
+  // Dequantization slot of quantized meshes, UINT32_MAX otherwise
+  uint32_t mesh;
+};
+
+// Process wide storage for static vertex and index data. Meshes are
+// sub-allocated from a few large immutable buffers (pages), and every vertex
+// format has a single VAO, so drawing different models only switches buffers
+// when they live in different pages
+class GeometryArena {
+public:
+  static auto Get() -> GeometryArena&;
+
+  // uploads the data, the range is given back when the last reference is
+  // dropped. nullptr if the GL buffers could not be created
+  auto Allocate(std::span<const pdx::Vertex> vertices,
+                std::span<const uint32_t> indices)
+      -> std::shared_ptr<const pdx::GeometryRange>;
+  auto Allocate(std::span<const pdx::QuantizedVertex> vertices,
+                std::span<const uint32_t> indices,
+                const pdx::Dequantization& dequantization)
+      -> std::shared_ptr<const pdx::GeometryRange>;
+
+  // binds the VAO of the range's format with its page attached, and the
+  // Mesh block for quantized ranges
+  auto Bind(const pdx::GeometryRange& range) -> void;
+  // binds the range like Bind and feeds INSTANCE_ATTRIB from one mat4 per
+  // instance starting at offset in buffer
+  auto BindInstances(const pdx::GeometryRange& range, GLuint buffer,
+                     GLintptr offset) -> void;
+
+  // deletes every page and VAO, must be called while the GL context is
+  // current and after all models are gone
+  auto Clear() -> void;
+
+  auto Pages() const -> size_t;
+  auto UsedBytes() const -> size_t;
+  auto CapacityBytes() const -> size_t;
+  // vertex and index bytes of one range
+  static auto Bytes(const pdx::GeometryRange& range) -> size_t;
+
+  static constexpr size_t PAGE_VERTEX_BYTES = 32 * 1024 * 1024;
+  static constexpr size_t PAGE_INDEX_BYTES = 16 * 1024 * 1024;
+  // Every VAO feeds this attribute from a per instance buffer holding
+  // 0, 1, 2, ... so a draw's baseInstance shows up in the vertex shader as
+  // its draw id. Plain draws always read 0
+  static constexpr GLuint DRAW_ID_ATTRIB = 5;
+  static constexpr uint32_t MAX_DRAW_IDS = 4096;
+  // first of the four columns of a per instance mat4
+  static constexpr GLuint INSTANCE_ATTRIB = 6;
+
+private:
+  GeometryArena() = default;
+
+  struct Page {
+    pdx::VertexFormat format;
+    pdx::vbo_t vbo;
+    pdx::ebo_t ebo;
+    // in vertices and indices
+    pdx::RangeAllocator vertices;
+    pdx::RangeAllocator indices;
+  };
+
+  struct FormatState {
+    pdx::vao_t vao = 0;
+    // page whose buffers are attached to the VAO
+    uint32_t page = UINT32_MAX;
+  };
+
+  auto Allocate(pdx::VertexFormat format, std::span<const std::byte> vertices,
+                std::span<const uint32_t> indices, uint32_t mesh)
+      -> std::shared_ptr<const pdx::GeometryRange>;
+  auto AllocateMesh(const pdx::Dequantization& dequantization) -> uint32_t;
+  auto CreatePage(pdx::VertexFormat format, size_t vertexCount,
+                  size_t indexCount) -> uint32_t;
+  auto CreateVertexArray(pdx::VertexFormat format) -> pdx::vao_t;
+  auto Free(const pdx::GeometryRange& range) -> void;
+
+  std::vector<Page> m_Pages;
+  pdx::vbo_t m_DrawIds = 0;
+  // one Dequantization per quantized range, m_MeshStride bytes apart
+  pdx::ubo_t m_Meshes = 0;
+  GLsizeiptr m_MeshStride = 0;
+  pdx::RangeAllocator m_MeshSlots;
+  uint32_t m_BoundMesh = UINT32_MAX;
+  FormatState m_Formats[(size_t)pdx::VertexFormat::COUNT];
+  // bumped by Clear so ranges that outlive it are not freed into new pages
+  uint32_t m_Generation = 0;
+};
+} // namespace pdx
+
+#endif /*  __HPP_PARADOX_GEOMETRYARENA__ */
@@ -0,0 +1,67 @@
+#ifndef __HPP_PARADOX_GLEXTENSIONS__
+#define __HPP_PARADOX_GLEXTENSIONS__
+
+#include <glad/gl.h>
+
+// glad is generated for the plain 4.3 core profile, anything newer is looked
+// up by hand once the context exists
+#ifndef GL_COMPLETION_STATUS_KHR
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+#endif
+
+#ifndef GL_DYNAMIC_STORAGE_BIT
+#define GL_DYNAMIC_STORAGE_BIT 0x0100
+#endif
+
+// GL_EXT_texture_filter_anisotropic, core in 4.6
+#ifndef GL_TEXTURE_MAX_ANISOTROPY
+#define GL_TEXTURE_MAX_ANISOTROPY 0x84FE
+#endif
+#ifndef GL_MAX_TEXTURE_MAX_ANISOTROPY
+#define GL_MAX_TEXTURE_MAX_ANISOTROPY 0x84FF
+#endif
+
+// GL_EXT_texture_compression_s3tc and GL_EXT_texture_sRGB
+#ifndef GL_COMPRESSED_RGBA_S3TC_DXT1_EXT
+#define GL_COMPRESSED_RGBA_S3TC_DXT1_EXT 0x83F1
+#endif
+#ifndef GL_COMPRESSED_RGBA_S3TC_DXT5_EXT
+#define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT 0x83F3
+#endif
+#ifndef GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT1_EXT
+#define GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT1_EXT 0x8C4D
+#endif
+#ifndef GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT
+#define GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT 0x8C4F
+#endif
+
+typedef void(GLAD_API_PTR *PFNGLMAXSHADERCOMPILERTHREADSKHRPROC)(GLuint count);
+typedef void(GLAD_API_PTR *PFNGLBUFFERSTORAGEPROC)(GLenum target,
+                                                   GLsizeiptr size,
+                                                   const void *data,
+                                                   GLbitfield flags);
+
+namespace pdx {
+struct GLExtensions {
+  // GL_KHR_parallel_shader_compile or GL_ARB_parallel_shader_compile
+  bool parallelShaderCompile = false;
+  PFNGLMAXSHADERCOMPILERTHREADSKHRPROC MaxShaderCompilerThreads = nullptr;
+  // GL 4.4 or GL_ARB_buffer_storage, immutable buffers
+  PFNGLBUFFERSTORAGEPROC BufferStorage = nullptr;
+  // 0 without anisotropic filtering
+  float maxAnisotropy = 0.0f;
+  bool textureCompressionS3tc = false;
+  // the sRGB S3TC formats, GL_EXT_texture_sRGB or
+  // GL_EXT_texture_compression_s3tc_srgb on top of S3TC
+  bool textureCompressionS3tcSrgb = false;
+  // glMultiDrawElementsIndirect with storage buffers, GL 4.3 or
+  // GL_ARB_multi_draw_indirect and GL_ARB_shader_storage_buffer_object
+  bool multiDrawIndirect = false;
+
+  // must be called after gladLoaderLoadGL
+  static auto Load() -> void;
+  static auto Get() -> const GLExtensions&;
+};
+} // namespace pdx
+
+#endif /*  __HPP_PARADOX_GLEXTENSIONS__ */
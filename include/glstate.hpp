@@ -0,0 +1,104 @@
+#ifndef __HPP_PARADOX_GLSTATE__
+#define __HPP_PARADOX_GLSTATE__
+
+#include <glad/gl.h>
+
+#include <array>
+
+#include "types.hpp"
+
+namespace pdx {
+// Shadows the GL state the renderer touches and only forwards calls that
+// actually change something. Everything that binds or toggles this state has
+// to go through here, Invalidate resynchronizes after foreign code
+class GLState {
+public:
+  static auto Get() -> GLState&;
+
+  auto Enable(GLenum cap) -> void;
+  auto Disable(GLenum cap) -> void;
+
+  auto UseProgram(pdx::program_t program) -> void;
+  auto BindVertexArray(pdx::vao_t vao) -> void;
+  auto BindTexture(uint32_t unit, GLenum target, GLuint texture) -> void;
+  auto BindSampler(uint32_t unit, GLuint sampler) -> void;
+
+  // deletes the object and forgets it if it is the one currently bound
+  auto DeleteProgram(pdx::program_t program) -> void;
+  auto DeleteVertexArray(pdx::vao_t vao) -> void;
+  auto DeleteTexture(GLuint texture) -> void;
+  auto DeleteSampler(GLuint sampler) -> void;
+
+  auto ColorMask(GLboolean red, GLboolean green, GLboolean blue,
+                 GLboolean alpha) -> void;
+  auto DepthMask(GLboolean flag) -> void;
+  auto DepthFunc(GLenum func) -> void;
+  auto CullFace(GLenum mode) -> void;
+  auto BlendFunc(GLenum sfactor, GLenum dfactor) -> void;
+  // the box only, GL_SCISSOR_TEST is toggled with Enable and Disable
+  auto Scissor(GLint x, GLint y, GLsizei width, GLsizei height) -> void;
+
+  auto StencilFuncSeparate(GLenum face, GLenum func, GLint ref, GLuint mask)
+      -> void;
+  auto StencilOpSeparate(GLenum face, GLenum sfail, GLenum dpfail,
+                         GLenum dppass) -> void;
+  auto StencilMaskSeparate(GLenum face, GLuint mask) -> void;
+
+  // forgets all shadowed values so the next call of each kind is issued
+  auto Invalidate() -> void;
+
+  // invalidates and moves the counters of the frame that just ended into
+  // the Last* getters
+  auto BeginFrame() -> void;
+  auto LastIssued() const -> uint32_t;
+  auto LastFiltered() const -> uint32_t;
+
+private:
+  static constexpr uint32_t MAX_TEXTURE_UNITS = 16;
+  // sentinel that never matches a real GL value
+  static constexpr uint32_t UNKNOWN = 0xFFFFFFFF;
+
+  struct StencilFace {
+    GLenum func;
+    GLint ref;
+    GLuint funcMask;
+    GLenum sfail;
+    GLenum dpfail;
+    GLenum dppass;
+    // wide enough to hold an unknown marker next to every 32 bit mask
+    int64_t writeMask;
+  };
+
+  GLState();
+
+  // bumps the issued or filtered counter and returns changed
+  auto Count(bool changed) -> bool;
+  // returns true and updates the shadow if value differs
+  template <typename T> auto Update(T& shadow, const T& value) -> bool;
+  auto SetCap(GLenum cap, bool enabled) -> void;
+  auto ActiveTexture(uint32_t unit) -> void;
+
+  // GL_BLEND, GL_CULL_FACE, GL_DEPTH_TEST, GL_SCISSOR_TEST, GL_STENCIL_TEST
+  std::array<uint32_t, 5> m_Caps;
+  pdx::program_t m_Program;
+  pdx::vao_t m_Vao;
+  uint32_t m_ActiveTexture;
+  std::array<GLuint, MAX_TEXTURE_UNITS> m_Textures;
+  std::array<GLuint, MAX_TEXTURE_UNITS> m_Samplers;
+  uint32_t m_ColorMask;
+  uint32_t m_DepthMask;
+  GLenum m_DepthFunc;
+  GLenum m_CullFace;
+  std::array<GLenum, 2> m_BlendFunc;
+  std::array<GLint, 4> m_Scissor;
+  StencilFace m_StencilFront;
+  StencilFace m_StencilBack;
+
+  uint32_t m_Issued = 0;
+  uint32_t m_Filtered = 0;
+  uint32_t m_LastIssued = 0;
+  uint32_t m_LastFiltered = 0;
+};
+} // namespace pdx
+
+#endif /*  __HPP_PARADOX_GLSTATE__ */
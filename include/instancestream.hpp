@@ -0,0 +1,41 @@
+#ifndef __HPP_PARADOX_INSTANCESTREAM__
+#define __HPP_PARADOX_INSTANCESTREAM__
+
+#include <glad/gl.h>
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+namespace pdx {
+// Ring buffer for per instance transforms written every frame. Data is
+// appended behind what earlier draws still read, once the ring is full its
+// storage is orphaned and writing starts over at the front
+class InstanceStream {
+public:
+  static auto Get() -> InstanceStream&;
+
+  // byte offset of the transforms in Buffer()
+  auto Push(std::span<const glm::mat4> transforms) -> GLintptr;
+  auto Buffer() const -> GLuint;
+
+  auto BeginFrame() -> void;
+  auto InstancesThisFrame() const -> uint32_t;
+
+  // deletes the buffer, must be called while the GL context is current
+  auto Clear() -> void;
+
+  static constexpr size_t CAPACITY = 4 * 1024 * 1024;
+
+private:
+  InstanceStream() = default;
+
+  GLuint m_Buffer = 0;
+  size_t m_Capacity = 0;
+  size_t m_Head = 0;
+  uint32_t m_Instances = 0;
+};
+} // namespace pdx
+
+#endif /*  __HPP_PARADOX_INSTANCESTREAM__ */
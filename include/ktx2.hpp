@@ -0,0 +1,44 @@
+#ifndef __HPP_PARADOX_KTX2__
+#define __HPP_PARADOX_KTX2__
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+
+#include "meshdata.hpp"
+
+namespace pdx {
+// Minimal KTX2 container support: single layer 2D images with a full or
+// partial mip chain and no supercompression, which is what pdxcook writes
+namespace Ktx2 {
+// the VkFormat values the cooker produces
+enum Format : uint32_t {
+  R8_UNORM = 9,
+  R8G8_UNORM = 16,
+  R8G8B8A8_UNORM = 37,
+  R8G8B8A8_SRGB = 43,
+  BC1_RGBA_UNORM = 133,
+  BC1_RGBA_SRGB = 134,
+  BC3_UNORM = 137,
+  BC3_SRGB = 138,
+  BC4_UNORM = 139,
+  BC5_UNORM = 141,
+};
+
+auto IsBlockCompressed(uint32_t vkFormat) -> bool;
+// bytes per 4x4 block for compressed formats, per pixel otherwise
+auto FormatBytes(uint32_t vkFormat) -> uint32_t;
+auto LevelSize(uint32_t vkFormat, int32_t width, int32_t height) -> size_t;
+// levels of a full mip chain down to 1x1
+auto MipLevels(int32_t width, int32_t height) -> int32_t;
+
+// fills width, height, vkFormat, pixels and mips of texture
+auto Read(const uint8_t *data, size_t size, pdx::MeshTexture& texture)
+    -> bool;
+// writes texture.pixels laid out as described by texture.mips
+auto Write(const std::filesystem::path& path, const pdx::MeshTexture& texture)
+    -> bool;
+} // namespace Ktx2
+} // namespace pdx
+
+#endif /*  __HPP_PARADOX_KTX2__ */
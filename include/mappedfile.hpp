@@ -0,0 +1,40 @@
+#ifndef __HPP_PARADOX_MAPPEDFILE__
+#define __HPP_PARADOX_MAPPEDFILE__
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+
+namespace pdx {
+// Read only view of a whole file mapped into memory
+class MappedFile {
+public:
+  MappedFile(const MappedFile&) = delete;
+  MappedFile(MappedFile&& other) noexcept;
+  ~MappedFile();
+
+  auto operator=(const MappedFile&) -> MappedFile& = delete;
+  auto operator=(MappedFile&& other) noexcept -> MappedFile&;
+
+  static auto Open(const std::filesystem::path& path)
+      -> std::optional<MappedFile>;
+
+  auto Data() const -> const uint8_t *;
+  auto Size() const -> size_t;
+
+private:
+  MappedFile() = default;
+
+  auto Close() -> void;
+
+  const uint8_t *m_Data = nullptr;
+  size_t m_Size = 0;
+#ifdef _WIN32
+  void *m_File = nullptr;
+  void *m_Mapping = nullptr;
+#endif
+};
+} // namespace pdx
+
+#endif /*  __HPP_PARADOX_MAPPEDFILE__ */
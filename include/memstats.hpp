@@ -0,0 +1,13 @@
+#ifndef __HPP_PARADOX_MEMSTATS__
+#define __HPP_PARADOX_MEMSTATS__
+
+#include <cstddef>
+
+namespace pdx {
+// high water mark of the process resident set in bytes, 0 if unknown
+auto PeakResidentBytes() -> size_t;
+// current resident set in bytes, 0 if unknown
+auto CurrentResidentBytes() -> size_t;
+} // namespace pdx
+
+#endif /*  __HPP_PARADOX_MEMSTATS__ */
@@ -0,0 +1,52 @@
+#ifndef __HPP_PARADOX_MESHASSET__
+#define __HPP_PARADOX_MESHASSET__
+
+#include <filesystem>
+#include <memory>
+#include <optional>
+#include <vector>
+
+#include "meshdata.hpp"
+#include "texturecache.hpp"
+
+namespace pdx {
+// Everything needed to upload one model, with images already decoded.
+// Loading touches no GL state, so it can run on any thread, but the asset has
+// to be destroyed on the render thread as it may hold texture references
+struct MeshAsset {
+  std::filesystem::path path;
+  // geometry lives in the mapping for cooked meshes and in data otherwise
+  std::optional<pdx::MeshFile::CookedMesh> cooked;
+  pdx::MeshData data;
+  std::vector<pdx::MeshTexture> textures;
+  // per texture, set when the TextureCache already had it while loading. The
+  // image was not decoded then, and the reference keeps it resident
+  std::vector<pdx::TextureKey> textureKeys;
+  std::vector<std::shared_ptr<pdx::Texture>> residentTextures;
+
+  auto View() const -> pdx::MeshView;
+
+  // reorders glTF geometry and builds LODs like the cooker does, cooked
+  // meshes already are
+  auto Optimize() -> void;
+  // switches the view to pdx::QuantizedVertex, returns the bytes saved
+  auto Quantize() -> size_t;
+  // drops vertices, indices and the cooked mapping once they are on the GPU,
+  // only the textures are left in the view
+  auto ReleaseGeometry() -> void;
+
+  // cooked .pdxmesh next to file if it is up to date, glTF otherwise
+  static auto Load(const std::filesystem::path& file)
+      -> std::optional<MeshAsset>;
+  static auto FromGLTF(const std::filesystem::path& file)
+      -> std::optional<MeshAsset>;
+  static auto FromCooked(const std::filesystem::path& file)
+      -> std::optional<MeshAsset>;
+
+  // path of the cooked mesh belonging to a glTF source file
+  static auto CookedPath(const std::filesystem::path& file)
+      -> std::filesystem::path;
+};
+} // namespace pdx
+
+#endif /*  __HPP_PARADOX_MESHASSET__ */
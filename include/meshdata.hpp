@@ -0,0 +1,234 @@
+#ifndef __HPP_PARADOX_MESHDATA__
+#define __HPP_PARADOX_MESHDATA__
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <span>
+#include <string>
+#include <vector>
+
+#include "mappedfile.hpp"
+
+namespace tinygltf {
+class Model;
+}
+
+namespace pdx {
+// interleaved vertex shared by every mesh, attribute locations match the
+// layout(location = n) declarations in data/shaders
+struct Vertex {
+  glm::vec3 position;  // 0
+  glm::vec3 normal;    // 1
+  glm::vec4 tangent;   // 2
+  glm::vec2 texcoord0; // 3
+  glm::vec2 texcoord1; // 4
+};
+
+// 24 byte alternative to Vertex made by MeshData::Quantize. position is
+// snorm16 inside the mesh bounds with the tangent handedness in w, normal and
+// tangent are octahedral snorm16, texcoords unorm16 inside their bounds
+struct QuantizedVertex {
+  int16_t position[4];   // 0
+  int16_t normal[2];     // 1
+  int16_t tangent[2];    // 2
+  uint16_t texcoord0[2]; // 3
+  uint16_t texcoord1[2]; // 4
+};
+
+// maps quantized attributes back, value = quantized * scale + offset. Laid
+// out like the std140 Mesh block in data/shaders/*.vert
+struct Dequantization {
+  glm::vec4 positionScale;
+  glm::vec4 positionOffset;
+  // per texcoord set, xy scale and zw offset
+  glm::vec4 texcoord[2];
+};
+
+// one primitive, indices are relative to baseVertex. Its vertices are in
+// model space, FromGLTF bakes the node transforms into them
+struct MeshPacket {
+  uint32_t mode;
+  uint32_t firstIndex;
+  uint32_t indexCount;
+  int32_t baseVertex;
+  int32_t material;
+  glm::vec3 boundsMin;
+  glm::vec3 boundsMax;
+  // simplified versions, coarsest last, in lods [firstLod, firstLod +
+  // lodCount). They index the same vertices as the packet
+  uint32_t firstLod;
+  uint32_t lodCount;
+};
+
+// one simplified index list of a packet, indices are relative to baseVertex
+struct MeshLod {
+  uint32_t firstIndex;
+  uint32_t indexCount;
+  // bound on how far the surface moved from the full packet, in the units of
+  // the packet's vertex positions
+  float error;
+};
+
+// packets [firstPacket, firstPacket + packetCount) belong to a scene root node
+struct MeshNode {
+  std::string name;
+  uint32_t firstPacket;
+  uint32_t packetCount;
+};
+
+// one level of a pre-built mip chain, offset and size index into pixels
+struct MeshMip {
+  int32_t width;
+  int32_t height;
+  size_t offset;
+  size_t size;
+};
+
+struct MeshTexture {
+  // relative to the asset directory, empty for embedded images
+  std::string uri;
+  int32_t minFilter;
+  int32_t magFilter;
+  int32_t wrapS;
+  int32_t wrapT;
+  // color data (base color, emissive) as opposed to normals or masks
+  bool srgb = false;
+  // decoded pixels if they are already in memory, otherwise uri is loaded
+  int32_t width = 0;
+  int32_t height = 0;
+  int32_t components = 0;
+  int32_t bits = 8;
+  std::vector<uint8_t> pixels;
+  // VkFormat of a KTX2 image, 0 for plain pixels. Pre-built images carry
+  // every mip level in pixels, plain ones get their chain generated
+  uint32_t vkFormat = 0;
+  std::vector<pdx::MeshMip> mips;
+};
+
+// Non owning view of ready to upload mesh data, either pointing into a
+// MeshData or straight into a mapped .pdxmesh file
+struct MeshView {
+  std::span<const pdx::Vertex> vertices;
+  std::span<const uint32_t> indices;
+  std::span<const pdx::MeshPacket> packets;
+  std::span<const pdx::MeshNode> nodes;
+  std::span<const pdx::MeshTexture> textures;
+  // used instead of vertices when not empty
+  std::span<const pdx::QuantizedVertex> quantizedVertices = {};
+  pdx::Dequantization dequantization = {};
+  std::span<const pdx::MeshLod> lods = {};
+};
+
+struct MeshData {
+  std::vector<pdx::Vertex> vertices;
+  std::vector<uint32_t> indices;
+  std::vector<pdx::MeshPacket> packets;
+  std::vector<pdx::MeshNode> nodes;
+  std::vector<pdx::MeshTexture> textures;
+  std::vector<pdx::QuantizedVertex> quantizedVertices;
+  pdx::Dequantization dequantization = {};
+  std::vector<pdx::MeshLod> lods;
+
+  auto View() const -> pdx::MeshView;
+
+  // fills quantized with one QuantizedVertex per vertex, the returned
+  // ranges restore the original values within the quantization error
+  static auto Quantize(std::span<const pdx::Vertex> vertices,
+                       std::vector<pdx::QuantizedVertex>& quantized)
+      -> pdx::Dequantization;
+
+  static auto FromGLTF(const tinygltf::Model& model) -> pdx::MeshData;
+};
+
+// On disk layout of a cooked .pdxmesh file. All sections are aligned to
+// ALIGNMENT so vertex and index data can be used in place
+namespace MeshFile {
+constexpr uint32_t MAGIC = 0x4D584450; // "PDXM"
+// 4 dropped the node transform from MeshPacket, 5 added SOURCES
+constexpr uint32_t VERSION = 5;
+constexpr uint32_t ALIGNMENT = 64;
+
+enum Section : uint32_t {
+  VERTICES,
+  INDICES,
+  PACKETS,
+  NODES,
+  TEXTURES,
+  STRINGS,
+  LODS,
+  SOURCES,
+  SECTION_COUNT
+};
+
+struct Range {
+  uint64_t offset;
+  uint64_t size;
+};
+
+struct Header {
+  uint32_t magic;
+  uint32_t version;
+  // guards against reading files written with a different struct layout
+  uint32_t vertexSize;
+  uint32_t packetSize;
+  // HashSources of the glTF the mesh was cooked from
+  uint64_t sourceHash;
+  Range sections[SECTION_COUNT];
+};
+
+struct NodeRecord {
+  uint32_t nameOffset;
+  uint32_t nameLength;
+  uint32_t firstPacket;
+  uint32_t packetCount;
+};
+
+struct TextureRecord {
+  uint32_t uriOffset;
+  uint32_t uriLength;
+  int32_t minFilter;
+  int32_t magFilter;
+  int32_t wrapS;
+  int32_t wrapT;
+  uint32_t flags;
+};
+
+constexpr uint32_t TEXTURE_SRGB = 1;
+
+// a file besides the glTF the mesh was cooked from, its uri is relative to
+// the glTF's directory
+struct SourceRecord {
+  uint32_t uriOffset;
+  uint32_t uriLength;
+};
+
+// 64 bit FNV-1a of the file contents, 0 if it cannot be read
+auto HashFile(const std::filesystem::path& path) -> uint64_t;
+// HashFile of gltf continued over every file in sources, so an edited
+// buffer or image changes it too. 0 if any of them cannot be read
+auto HashSources(const std::filesystem::path& gltf,
+                 std::span<const std::string> sources) -> uint64_t;
+
+// sources are the external buffers and images sourceHash covers
+auto Write(const std::filesystem::path& path, const pdx::MeshView& mesh,
+           uint64_t sourceHash, std::span<const std::string> sources) -> bool;
+
+// A mapped .pdxmesh. Vertex, index and packet spans point into the mapping
+// and stay valid as long as the CookedMesh is alive
+struct CookedMesh {
+  pdx::MappedFile file;
+  uint64_t sourceHash;
+  std::vector<std::string> sources;
+  std::vector<pdx::MeshNode> nodes;
+  std::vector<pdx::MeshTexture> textures;
+  pdx::MeshView view;
+};
+
+auto Read(const std::filesystem::path& path) -> std::optional<CookedMesh>;
+} // namespace MeshFile
+} // namespace pdx
+
+#endif /*  __HPP_PARADOX_MESHDATA__ */
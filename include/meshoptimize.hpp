@@ -0,0 +1,76 @@
+#ifndef __HPP_PARADOX_MESHOPTIMIZE__
+#define __HPP_PARADOX_MESHOPTIMIZE__
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+#include "meshdata.hpp"
+
+namespace pdx {
+// Reorders triangle lists for the post transform vertex cache, overdraw and
+// vertex fetch, and simplifies them into levels of detail. GL free, used by
+// the cooker and optionally at load time. Indices are relative to the start
+// of the vertex span they index
+namespace MeshOptimize {
+// FIFO size the statistics are simulated with
+constexpr uint32_t CACHE_SIZE = 16;
+
+struct Stats {
+  // average cache miss ratio, transformed vertices per triangle
+  float acmr;
+  // average transform to vertex ratio, 1 is ideal
+  float atvr;
+  // bytes read from the vertex buffer over the bytes actually needed, with
+  // 64 byte cache lines
+  float overfetch;
+};
+
+auto Analyze(std::span<const uint32_t> indices, size_t vertexCount,
+             size_t vertexSize, uint32_t cacheSize = CACHE_SIZE) -> Stats;
+// every triangle packet of mesh, weighted by triangle count
+auto Analyze(const pdx::MeshView& mesh) -> Stats;
+
+// Forsyth's linear speed vertex cache optimization
+auto OptimizeVertexCache(std::span<uint32_t> indices, size_t vertexCount)
+    -> void;
+// Splits cache optimized indices into clusters and sorts them outside in, so
+// front facing parts tend to be drawn first. Clusters are only cut where the
+// ACMR stays below threshold times that of the input
+auto OptimizeOverdraw(std::span<uint32_t> indices,
+                      std::span<const pdx::Vertex> vertices,
+                      float threshold = 1.05f) -> void;
+// stores vertices in the order they are first referenced, unreferenced ones
+// are moved to the end. Returns the number of referenced vertices
+auto OptimizeVertexFetch(std::span<uint32_t> indices,
+                         std::span<pdx::Vertex> vertices) -> size_t;
+
+// Collapses edges of a triangle list until at most targetIndexCount indices
+// are left, or until the next collapse would move the surface further than
+// targetError. Vertices are only referenced less, never moved, and attribute
+// seams and open borders are kept. Returns the new index count, error is set
+// to how far the surface moved
+auto Simplify(std::span<uint32_t> indices,
+              std::span<const pdx::Vertex> vertices, size_t targetIndexCount,
+              float targetError, float& error) -> size_t;
+
+struct Report {
+  pdx::MeshOptimize::Stats before;
+  pdx::MeshOptimize::Stats after;
+  // triangle list packets that were optimized
+  size_t packets;
+};
+
+// runs all three passes over every triangle list packet of mesh
+auto Optimize(pdx::MeshData& mesh) -> Report;
+
+// most simplified levels BuildLods adds per packet
+constexpr uint32_t MAX_LODS = 4;
+
+// appends a chain of ever coarser index lists to every triangle list packet,
+// run it after Optimize. Returns the number of levels built
+auto BuildLods(pdx::MeshData& mesh) -> size_t;
+} // namespace MeshOptimize
+} // namespace pdx
+
+#endif /*  __HPP_PARADOX_MESHOPTIMIZE__ */
@@ -2,34 +2,157 @@
 #define __HPP_PARADOX_MODEL__
 
 #include <glad/gl.h>
+#include <glm/glm.hpp>
 
-#include <map>
+#include <memory>
 #include <optional>
+#include <span>
+#include <string>
+#include <vector>
 
-#include <tiny_gltf.h>
-
+#include "geometryarena.hpp"
+#include "meshasset.hpp"
+#include "meshdata.hpp"
+#include "texture.hpp"
 #include "types.hpp"
 
 namespace pdx {
+// axis aligned box
+struct Bounds {
+  glm::vec3 min;
+  glm::vec3 max;
+};
+
+// everything needed to issue one primitive, resolved once at load time
+struct DrawPacket {
+  GLenum mode;
+  GLsizei indexCount;
+  // byte offset into the arena page's uint32 index buffer
+  uintptr_t indexOffset;
+  GLint baseVertex;
+  int32_t material;
+  // model space bounding box and sphere
+  pdx::Bounds bounds;
+  glm::vec3 center;
+  float radius;
+  // coarser versions in the model's LODs [firstLod, firstLod + lodCount)
+  uint32_t firstLod;
+  uint32_t lodCount;
+};
+
+// index range of a simplified packet, drawn with the packet's baseVertex
+struct LodRange {
+  GLsizei indexCount;
+  uintptr_t indexOffset;
+  // how far the surface moved from the full packet, in model space
+  float error;
+};
+
+// per view input of Model::SelectLod
+struct LodView {
+  glm::mat4 view = glm::mat4(1.0f);
+  // projection[1][1] * viewport height / 2, the pixels one unit covers at
+  // distance 1. 0 keeps every packet at full detail
+  float pixelScale = 0.0f;
+  // screen space error a level may have, in pixels
+  float maxError = 1.0f;
+  // levels added after the selection, e.g. for views through nested portals
+  uint32_t bias = 0;
+};
+
+// packets [first, first + count) belong to the scene root node called name
+struct NodeRange {
+  std::string name;
+  uint32_t first;
+  uint32_t count;
+};
+
+// memory a model keeps resident
+struct ModelMemory {
+  // packets, LODs, node names and texture slots
+  size_t cpu;
+  // the model's slice of the GeometryArena
+  size_t geometry;
+  // shared with other models using the same image, so totals over several
+  // models count them more than once
+  size_t textures;
+};
+
+// Runtime form of a loaded mesh, the source asset is dropped once it is
+// uploaded. Move only, so the packets are never duplicated by accident
 class Model {
 public:
+  Model(const Model&) = delete;
+  Model(Model&&) = default;
+
+  auto operator=(const Model&) -> Model& = delete;
+  auto operator=(Model&&) -> Model& = default;
+
   auto Draw() const -> void;
   auto Draw(const std::string& name) const -> void;
+  // index of the scene root node called name or -1, resolve once and use
+  // DrawNode to avoid the string compare
+  auto NodeIndex(const std::string& name) const -> int;
+  // model space box around the packets of a node, or of the whole model for
+  // node -1. Nothing if there are no packets
+  auto NodeBounds(int node) const -> std::optional<pdx::Bounds>;
+  auto DrawNode(int node) const -> void;
+  // one instance per transform, read by shaders built with INSTANCED.
+  // The model matrix uniform is not used
+  auto DrawInstanced(std::span<const glm::mat4> transforms) const -> void;
+  auto DrawNodeInstanced(int node, std::span<const glm::mat4> transforms) const
+      -> void;
+
+  // uploads everything at once, see AssetLoader for the staged version
+  static auto FromAsset(const pdx::MeshAsset& asset) -> Model;
+
+  // vertex, index and packet data only, every texture slot starts out empty
+  // and is filled in with SetTexture
+  static auto FromGeometry(const pdx::MeshView& mesh) -> Model;
+  auto SetTexture(size_t index, std::shared_ptr<pdx::Texture> texture)
+      -> void;
+
+  // packets of a scene root node, or of the whole model for node -1
+  auto Packets(int node = -1) const -> std::span<const pdx::DrawPacket>;
+  // state for draws the caller issues itself, e.g. through a DrawList
+  auto BindTextures() const -> void;
+  // false if the model has no geometry to draw
+  auto BindGeometry() const -> bool;
+
+  auto Memory() const -> pdx::ModelMemory;
+  // texture slots, empty ones are nullptr
+  auto Textures() const -> std::span<const std::shared_ptr<pdx::Texture>>;
 
-  static auto FromGLTF(const std::filesystem::path& file)
-      -> std::optional<Model>;
+  // coarsest level of packet whose projected error stays within
+  // view.maxError, plus view.bias. 0 is the full packet, transform is the
+  // model matrix
+  auto SelectLod(const pdx::DrawPacket& packet, const glm::mat4& transform,
+                 const pdx::LodView& view) const -> uint32_t;
+  // index range of packet at level, level 0 is the packet itself
+  auto Lod(const pdx::DrawPacket& packet, uint32_t level) const
+      -> pdx::LodRange;
+  // like DrawNode with every packet at its selected level, node -1 draws
+  // the whole model. Returns the number of indices drawn
+  auto DrawLod(int node, const glm::mat4& transform,
+               const pdx::LodView& view) const -> size_t;
 
 private:
-  Model(tinygltf::Model& model, std::map<std::string, pdx::vao_t> vaos,
-        std::map<int, GLuint> vbos, std::map<int, GLuint> textures);
+  Model() = default;
 
-  auto DrawMesh(const tinygltf::Mesh& mesh) const -> void;
-  auto DrawNodes(const tinygltf::Node& node) const -> void;
+  auto DrawPackets(uint32_t first, uint32_t count) const -> void;
+  auto DrawPacketsInstanced(uint32_t first, uint32_t count,
+                            std::span<const glm::mat4> transforms) const
+      -> void;
 
-  tinygltf::Model m_Model;
-  std::map<std::string, pdx::vao_t> m_Vaos;
-  std::map<int, pdx::ebo_t> m_Ebos;
-  std::map<int, GLuint> m_Textures;
+  // vertices and indices live in the GeometryArena
+  std::shared_ptr<const pdx::GeometryRange> m_Geometry;
+  std::vector<pdx::DrawPacket> m_Packets;
+  std::vector<pdx::LodRange> m_Lods;
+  std::vector<pdx::NodeRange> m_Nodes;
+  // shared with every other model using the same image and sampler
+  std::vector<std::shared_ptr<pdx::Texture>> m_Textures;
+  // owned by the SamplerCache
+  std::vector<GLuint> m_Samplers;
 };
 } // namespace pdx
 
@@ -3,26 +3,50 @@
 
 #include "camera.hpp"
 #include "shader.hpp"
+#include "types.hpp"
 #include <memory>
+#include <optional>
+#include <span>
 
 namespace pdx {
+class AssetLoader;
+class DrawList;
+class Model;
+
 class Portal {
 public:
-  Portal(const pdx::Camera& viewPoint);
+  Portal(const pdx::Camera& viewPoint, pdx::AssetLoader& assets);
 
   auto Position() const -> glm::vec3;
   auto Front() const -> glm::vec3;
   auto Right() const -> glm::vec3;
   auto ModelMatrix() const -> glm::mat4;
+  auto InverseModelMatrix() const -> const glm::mat4&;
+  // takes the world in front of the destination to where it is seen behind
+  // this portal, view * PairTransform() is the view through the portal
+  auto PairTransform() const -> const glm::mat4&;
   auto ViewMatrix() const -> glm::mat4;
 
-  auto DrawPortalFrame(const glm::mat4& view, const glm::mat4& proj,
-                       const pdx::Shader& shader) const -> void;
-  auto DrawPortalPlane(const glm::mat4& view, const glm::mat4& proj,
-                       const pdx::Shader& shader) const -> void;
+  // world space plane equation (normal, distance) of the portal surface
+  auto Plane() const -> glm::vec4;
+
+  // view and projection come from the currently bound Camera block
+  auto AddPortalFrame(pdx::DrawList& list) const -> void;
+  auto DrawPortalPlane(const pdx::Shader& shader) const -> void;
+  // every portal plane in one instanced draw, shader has to be built with
+  // INSTANCED
+  static auto DrawPortalPlanes(std::span<const pdx::Portal> portals,
+                               const pdx::Shader& shader) -> void;
 
+  // proj with its near plane moved onto the clip plane, view has to be rigid
+  // and proj a perspective projection, oblique ones included
   auto ClippedProj(const glm::mat4& view, const glm::mat4& proj) const
       -> glm::mat4;
+  // NDC rectangle (min x, min y, max x, max y) the portal plane covers
+  // within parent. Nothing if the plane is outside the frustum of viewProj,
+  // outside parent, or not loaded yet
+  auto ScreenRect(const glm::mat4& viewProj, const glm::vec4& parent) const
+      -> std::optional<glm::vec4>;
 
   auto SetDestination(pdx::Portal *portal) -> void;
   auto GetDestination() const -> pdx::Portal *;
@@ -31,10 +55,30 @@ public:
   auto AddAngle(float angle, const glm::vec3& axis) -> void;
 
 private:
+  // nullptr until the loader has uploaded the portal model
+  auto GetModel() const -> const pdx::Model *;
+  // recomputes everything derived from position and orientation
+  auto UpdateTransforms() -> void;
+
   glm::fquat m_Orientation;
   pdx::Camera m_Viewpoint;
-  pdx::Portal *m_Destination;
+  pdx::Portal *m_Destination = nullptr;
   glm::mat4 m_ModelMatrix;
+  glm::mat4 m_InverseModelMatrix;
+  glm::vec4 m_Plane;
+  // plane ClippedProj moves the near plane onto
+  glm::vec4 m_ClipPlane;
+  // bumped whenever the transforms change
+  uint32_t m_Revision = 0;
+  // PairTransform is current while both revisions still match
+  mutable glm::mat4 m_PairTransform;
+  mutable uint32_t m_PairRevision = UINT32_MAX;
+  mutable uint32_t m_PairDestinationRevision = UINT32_MAX;
+  const pdx::AssetLoader *m_Assets;
+  pdx::model_handle_t m_Model;
+  // resolved once the model is available
+  mutable int m_FrameNode = -1;
+  mutable int m_PlaneNode = -1;
 };
 } // namespace pdx
 
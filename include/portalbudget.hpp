@@ -0,0 +1,100 @@
+#ifndef __HPP_PARADOX_PORTALBUDGET__
+#define __HPP_PARADOX_PORTALBUDGET__
+
+#include <glad/gl.h>
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+namespace pdx {
+// deepest recursion the controller may pick, the stencil counts levels in 8
+// bits so this stays far below 255
+constexpr uint32_t MAX_PORTAL_DEPTH = 8;
+// views at level depth + 1 are still drawn, they just do not recurse
+constexpr uint32_t PORTAL_LEVELS = MAX_PORTAL_DEPTH + 2;
+
+struct PortalBudgetStats {
+  uint32_t depth;
+  // portal views that may recurse per frame, and how many did last frame
+  uint32_t viewBudget;
+  uint32_t recursedViews;
+  // smoothed GPU time of a whole frame and the target it is steered to
+  float frameMs;
+  float targetMs;
+  // smoothed GPU time and view count of every recursion level
+  std::array<float, PORTAL_LEVELS> levelMs;
+  std::array<float, PORTAL_LEVELS> levelViews;
+};
+
+// Chooses the portal recursion depth and how many portal views may recurse
+// per frame from measured GPU time. Mark splits the frame into spans, each is
+// timed with a pair of GL_TIMESTAMP queries and charged to the recursion
+// level it draws. Results are read a few frames late so the CPU never waits
+// on them. Over the target the deepest level goes first, since it covers the
+// least of the screen, under it a level is added once its estimated cost fits
+class PortalBudget {
+public:
+  // Mark level for spans that belong to no recursion level
+  static constexpr uint32_t NO_LEVEL = UINT32_MAX;
+
+  PortalBudget() = default;
+  PortalBudget(const PortalBudget&) = delete;
+
+  auto operator=(const PortalBudget&) -> PortalBudget& = delete;
+
+  // depth is used until the first measurements arrive, and for good when
+  // adaptive is false
+  auto Create(float targetMs, uint32_t depth, bool adaptive) -> void;
+  auto Destroy() -> void;
+
+  // reads back an old frame, adjusts depth and view budget, and starts
+  // timing this frame
+  auto BeginFrame() -> void;
+  // GPU work from here to the next Mark or EndFrame draws level
+  auto Mark(uint32_t level) -> void;
+  auto EndFrame() -> void;
+
+  // called for every visible portal of a view at level, whether the view
+  // behind it may recurse further or only draws the level
+  auto Recurse(uint32_t level) -> bool;
+
+  auto SetTarget(float targetMs) -> void;
+  auto Adaptive() const -> bool;
+  auto Stats() const -> PortalBudgetStats;
+
+private:
+  struct Frame {
+    std::vector<GLuint> queries;
+    // level of the span each query starts
+    std::vector<uint32_t> levels;
+    uint32_t used = 0;
+    std::array<uint32_t, PORTAL_LEVELS> views{};
+    uint32_t recursed = 0;
+  };
+
+  auto Read(Frame& frame) -> bool;
+  auto Adjust() -> void;
+
+  // frames in flight before a frame's queries are read
+  static constexpr uint32_t LATENCY = 3;
+  std::array<Frame, LATENCY> m_Frames;
+  uint32_t m_Current = 0;
+
+  bool m_Adaptive = true;
+  float m_TargetMs = 0.0f;
+  uint32_t m_Depth = 0;
+  uint32_t m_ViewBudget = UINT32_MAX;
+  uint32_t m_LastRecursed = 0;
+  // frames until the next adjustment may happen
+  uint32_t m_Cooldown = 0;
+
+  bool m_Measured = false;
+  float m_FrameMs = 0.0f;
+  float m_RecursedViews = 0.0f;
+  std::array<float, PORTAL_LEVELS> m_LevelMs{};
+  std::array<float, PORTAL_LEVELS> m_LevelViews{};
+};
+} // namespace pdx
+
+#endif /*  __HPP_PARADOX_PORTALBUDGET__ */
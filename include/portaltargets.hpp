@@ -0,0 +1,85 @@
+#ifndef __HPP_PARADOX_PORTALTARGETS__
+#define __HPP_PARADOX_PORTALTARGETS__
+
+#include <glad/gl.h>
+#include <glm/glm.hpp>
+
+#include <array>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace pdx {
+// texture unit the portal image is bound to, above the ones models use
+constexpr uint32_t PORTAL_VIEW_UNIT = 15;
+
+// Offscreen images of every portal's view for the render-to-texture portal
+// mode. Each portal has two color images with a shared depth buffer, views
+// drawn this frame read the other portals' images of the previous frame, so
+// a portal seen through portals repeats one frame later at every level
+// instead of being drawn again. An image is only redrawn when its camera or
+// the scene changed, or when an image it shows was redrawn, the latter only
+// a limited number of times in a row so facing portals settle
+class PortalTargets {
+public:
+  PortalTargets() = default;
+  PortalTargets(const PortalTargets&) = delete;
+
+  auto operator=(const PortalTargets&) -> PortalTargets& = delete;
+
+  auto Create(size_t count, GLsizei width, GLsizei height) -> void;
+  auto Destroy() -> void;
+  auto Size() const -> size_t;
+
+  // Binds and clears the framebuffer of portal's next image if the image
+  // drawn with viewProj, shown on a portal seen with surface, and showing
+  // the images of sources needs to be drawn. Returns false if the latest
+  // image is still good
+  auto Begin(uint32_t portal, const glm::mat4& viewProj,
+             const glm::mat4& surface, std::span<const uint32_t> sources,
+             bool sceneChanged) -> bool;
+  // makes the images drawn this frame the ones Texture returns and binds
+  // the default framebuffer
+  auto Present() -> void;
+
+  // latest image, 0 if there is none yet
+  auto Texture(uint32_t portal) const -> GLuint;
+  // view projection of the view the latest image is seen from, it maps the
+  // portal plane into the image
+  auto Surface(uint32_t portal) const -> const glm::mat4&;
+
+  // images drawn and reused in the last frame
+  auto Drawn() const -> uint32_t;
+  auto Cached() const -> uint32_t;
+
+private:
+  struct Target {
+    std::array<GLuint, 2> framebuffers{};
+    std::array<GLuint, 2> textures{};
+    GLuint depth = 0;
+    // image Texture returns
+    uint32_t current = 0;
+    bool valid = false;
+    // drawn this frame into the other image
+    bool pending = false;
+    // of the latest image drawn
+    glm::mat4 viewProj = glm::mat4(1.0f);
+    std::vector<uint32_t> sources;
+    // of each image
+    std::array<glm::mat4, 2> surfaces{glm::mat4(1.0f), glm::mat4(1.0f)};
+    // frame the latest image was drawn in
+    uint64_t frame = 0;
+    // frames of other images' latency that went into the latest image
+    uint32_t generation = 0;
+  };
+
+  std::vector<Target> m_Targets;
+  uint64_t m_Frame = 1;
+  uint32_t m_Drawn = 0;
+  uint32_t m_Cached = 0;
+  uint32_t m_LastDrawn = 0;
+  uint32_t m_LastCached = 0;
+};
+} // namespace pdx
+
+#endif /*  __HPP_PARADOX_PORTALTARGETS__ */
@@ -0,0 +1,42 @@
+#ifndef __HPP_PARADOX_PROGRAMCACHE__
+#define __HPP_PARADOX_PROGRAMCACHE__
+
+#include <filesystem>
+#include <string_view>
+
+#include "types.hpp"
+
+namespace pdx {
+// On disk cache of linked program binaries. Entries are keyed by a hash of the
+// final shader sources and tagged with the driver they were produced by, so a
+// driver update simply turns every entry into a miss
+class ProgramCache {
+public:
+  ProgramCache() = default;
+
+  static auto HashSources(std::string_view vertCode, std::string_view fragCode)
+      -> uint64_t;
+
+  // tries to load the binary for sourceHash into program, returns false if
+  // there is no usable entry and the program has to be compiled instead
+  auto Load(uint64_t sourceHash, pdx::program_t program) -> bool;
+  auto Store(uint64_t sourceHash, pdx::program_t program) -> void;
+
+  auto Hits() const -> uint32_t;
+  auto Misses() const -> uint32_t;
+
+private:
+  // queried lazily as the cache is created before the GL context
+  auto Init() -> void;
+  auto EntryPath(uint64_t sourceHash) const -> std::filesystem::path;
+
+  bool m_Initialized = false;
+  bool m_Supported = false;
+  uint64_t m_DriverHash = 0;
+  std::filesystem::path m_Dir;
+  uint32_t m_Hits = 0;
+  uint32_t m_Misses = 0;
+};
+} // namespace pdx
+
+#endif /*  __HPP_PARADOX_PROGRAMCACHE__ */
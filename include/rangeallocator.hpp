@@ -0,0 +1,33 @@
+#ifndef __HPP_PARADOX_RANGEALLOCATOR__
+#define __HPP_PARADOX_RANGEALLOCATOR__
+
+#include <cstdint>
+#include <map>
+#include <optional>
+
+namespace pdx {
+// First fit allocator over [0, capacity) in abstract units, used to carve
+// sub ranges out of large GL buffers. Freed ranges are merged with their
+// neighbours so the space can be reused by bigger allocations
+class RangeAllocator {
+public:
+  explicit RangeAllocator(uint64_t capacity = 0);
+
+  // offset of size free units, nothing if no free range is large enough
+  auto Allocate(uint64_t size) -> std::optional<uint64_t>;
+  auto Free(uint64_t offset, uint64_t size) -> void;
+  // appends [Capacity(), capacity) to the free space
+  auto Grow(uint64_t capacity) -> void;
+
+  auto Capacity() const -> uint64_t;
+  auto Used() const -> uint64_t;
+
+private:
+  // offset -> size of every free range
+  std::map<uint64_t, uint64_t> m_Free;
+  uint64_t m_Capacity;
+  uint64_t m_Used = 0;
+};
+} // namespace pdx
+
+#endif /*  __HPP_PARADOX_RANGEALLOCATOR__ */
@@ -0,0 +1,42 @@
+#ifndef __HPP_PARADOX_SAMPLERCACHE__
+#define __HPP_PARADOX_SAMPLERCACHE__
+
+#include <glad/gl.h>
+
+#include <cstdint>
+#include <map>
+#include <tuple>
+
+#include "meshdata.hpp"
+
+namespace pdx {
+// Sampler objects shared by every texture with the same filter and wrap
+// modes. Mipmapped samplers also get anisotropic filtering when available
+class SamplerCache {
+public:
+  static auto Get() -> SamplerCache&;
+
+  auto Acquire(const pdx::MeshTexture& texture) -> GLuint;
+
+  // clamped to what the driver supports, applies to existing samplers too
+  auto SetAnisotropy(float anisotropy) -> void;
+  auto Anisotropy() const -> float;
+
+  // deletes all samplers, must be called while the GL context is current
+  auto Clear() -> void;
+
+  static constexpr float DEFAULT_ANISOTROPY = 8.0f;
+
+private:
+  SamplerCache() = default;
+
+  auto Apply(GLuint sampler, GLint minFilter) const -> void;
+
+  // min filter, mag filter, wrap s, wrap t
+  using Key = std::tuple<int32_t, int32_t, int32_t, int32_t>;
+  std::map<Key, GLuint> m_Samplers;
+  float m_Anisotropy = DEFAULT_ANISOTROPY;
+};
+} // namespace pdx
+
+#endif /*  __HPP_PARADOX_SAMPLERCACHE__ */
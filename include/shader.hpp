@@ -2,6 +2,8 @@
 #define __HPP_PARADOX_SHADER__
 
 #include <string>
+#include <string_view>
+#include <vector>
 
 #include <glad/gl.h>
 #include <glm/glm.hpp>
@@ -10,29 +12,128 @@
 #include "types.hpp"
 
 namespace pdx {
+// 32 bit FNV-1a, constexpr so uniform names can be hashed at compile time
+constexpr auto HashName(std::string_view name) -> uint32_t {
+  uint32_t hash = 2166136261u;
+  for (char c : name) {
+    hash ^= static_cast<uint8_t>(c);
+    hash *= 16777619u;
+  }
+  return hash;
+}
+
+// Hashed uniform name. String literals convert implicitly and are hashed by
+// the compiler, runtime strings have to go through FromString
+struct UniformId {
+  template <size_t N>
+  consteval UniformId(const char (&name)[N])
+      : hash(HashName(std::string_view(name, N - 1))) {}
+
+  static constexpr auto FromString(std::string_view name) -> UniformId {
+    return UniformId(HashName(name));
+  }
+
+  uint32_t hash;
+
+private:
+  constexpr explicit UniformId(uint32_t value) : hash(value) {}
+};
+
+class ProgramCache;
+
 class Shader {
 public:
-  Shader(const std::string& vertFile, const std::string& fragFile);
+  // Submits compile and link without waiting for the driver, the program can
+  // be used once Poll returns true. binaries is optional, without it the
+  // program is always compiled from source
+  Shader(const std::string& vertFile, const std::string& fragFile,
+         const std::vector<std::string>& defines = {},
+         pdx::ProgramCache *binaries = nullptr);
+  Shader(const Shader&) = delete;
+  Shader(Shader&& other) noexcept;
+  ~Shader();
+
+  // compiles and links synchronously
+  static auto FromSource(const std::string& vertCode,
+                         const std::string& fragCode) -> Shader;
+
+  auto operator=(const Shader&) -> Shader& = delete;
+  auto operator=(Shader&& other) noexcept -> Shader&;
+
+  // finishes the program once the driver is done with it. Without
+  // parallelCompile completion cannot be queried and this blocks until the
+  // link has finished
+  auto Poll(bool parallelCompile) -> bool;
+  auto IsReady() const -> bool;
+  auto IsLinked() const -> bool;
+  // restored from the program binary cache instead of compiled
+  auto FromBinary() const -> bool;
 
   auto Use() const -> void;
 
-  auto Set1f(const std::string& name, float x) const -> void;
-  auto Set2f(const std::string& name, float x, float y) const -> void;
-  auto Set3f(const std::string& name, float x, float y, float z) const -> void;
-  auto Set4f(const std::string& name, float x, float y, float z, float w) const
+  // returns -1 for names that are not an active uniform of this program
+  auto Location(pdx::UniformId id) const -> pdx::uniform_t;
+
+  auto Set1f(pdx::UniformId id, float x) const -> void;
+  auto Set2f(pdx::UniformId id, float x, float y) const -> void;
+  auto Set3f(pdx::UniformId id, float x, float y, float z) const -> void;
+  auto Set4f(pdx::UniformId id, float x, float y, float z, float w) const
+      -> void;
+  auto Set1i(pdx::UniformId id, int x) const -> void;
+  auto Set2i(pdx::UniformId id, int x, int y) const -> void;
+  auto Set3i(pdx::UniformId id, int x, int y, int z) const -> void;
+  auto Set4i(pdx::UniformId id, int x, int y, int z, int w) const -> void;
+  auto SetMat4fv(pdx::UniformId id, const glm::mat4x4& value,
+                 bool transpose = false) const -> void;
+  auto Set2fv(pdx::UniformId id, const glm::vec2& value) const -> void;
+  auto Set3fv(pdx::UniformId id, const glm::vec3& value) const -> void;
+  auto Set4fv(pdx::UniformId id, const glm::vec4& value) const -> void;
+
+  auto Set1f(pdx::uniform_t location, float x) const -> void;
+  auto Set2f(pdx::uniform_t location, float x, float y) const -> void;
+  auto Set3f(pdx::uniform_t location, float x, float y, float z) const
       -> void;
-  auto Set1i(const std::string& name, int x) const -> void;
-  auto Set2i(const std::string& name, int x, int y) const -> void;
-  auto Set3i(const std::string& name, int x, int y, int z) const -> void;
-  auto Set4i(const std::string& name, int x, int y, int z, int w) const -> void;
-  auto SetMat4fv(const std::string& name, const glm::mat4x4& value,
+  auto Set4f(pdx::uniform_t location, float x, float y, float z,
+             float w) const -> void;
+  auto Set1i(pdx::uniform_t location, int x) const -> void;
+  auto Set2i(pdx::uniform_t location, int x, int y) const -> void;
+  auto Set3i(pdx::uniform_t location, int x, int y, int z) const -> void;
+  auto Set4i(pdx::uniform_t location, int x, int y, int z, int w) const
+      -> void;
+  auto SetMat4fv(pdx::uniform_t location, const glm::mat4x4& value,
                  bool transpose = false) const -> void;
-  auto Set2fv(const std::string& name, const glm::vec2& value) const -> void;
-  auto Set3fv(const std::string& name, const glm::vec3& value) const -> void;
-  auto Set4fv(const std::string& name, const glm::vec4& value) const -> void;
+  auto Set2fv(pdx::uniform_t location, const glm::vec2& value) const -> void;
+  auto Set3fv(pdx::uniform_t location, const glm::vec3& value) const -> void;
+  auto Set4fv(pdx::uniform_t location, const glm::vec4& value) const -> void;
 
 private:
-  pdx::program_t m_Program;
+  struct UniformSlot {
+    uint32_t hash;
+    pdx::uniform_t location;
+  };
+
+  Shader() = default;
+
+  auto Submit(const std::string& vertexCode, const std::string& fragCode)
+      -> void;
+  auto Finish() -> void;
+  auto ReflectUniforms() -> void;
+  auto Release() -> void;
+
+  pdx::program_t m_Program = 0;
+  // stages stay attached until Finish has read their compile logs
+  pdx::shader_t m_Vert = 0;
+  pdx::shader_t m_Frag = 0;
+  bool m_Pending = false;
+  bool m_Linked = false;
+  bool m_FromBinary = false;
+  std::string m_Name;
+  uint64_t m_SourceHash = 0;
+  uint64_t m_SubmitTime = 0;
+  pdx::ProgramCache *m_Binaries = nullptr;
+  // open addressing table with a power of two size, location -1 marks an
+  // empty slot
+  std::vector<UniformSlot> m_Uniforms;
 };
 } // namespace pdx
 
@@ -0,0 +1,84 @@
+#ifndef __HPP_PARADOX_SHADERCACHE__
+#define __HPP_PARADOX_SHADERCACHE__
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "programcache.hpp"
+#include "shader.hpp"
+#include "types.hpp"
+
+namespace pdx {
+// Owns every linked program. Each (vertex, fragment, defines) combination is
+// compiled once and afterwards referred to by a shader_handle_t. Programs are
+// compiled in the background, until one is ready its handle resolves to a
+// flat placeholder program for the same vertex format
+class ShaderCache {
+public:
+  ShaderCache() = default;
+  ShaderCache(const ShaderCache&) = delete;
+  ~ShaderCache();
+
+  auto operator=(const ShaderCache&) -> ShaderCache& = delete;
+
+  auto Load(const std::string& vertFile, const std::string& fragFile,
+            const std::vector<std::string>& defines = {})
+      -> pdx::shader_handle_t;
+  auto Get(pdx::shader_handle_t handle) const -> const pdx::Shader&;
+  // true once the program itself rather than the placeholder is returned by
+  // Get and it linked successfully
+  auto IsReady(pdx::shader_handle_t handle) const -> bool;
+
+  // finishes programs the driver is done with, call once per frame
+  auto Poll() -> void;
+  // recompiles every program from disk, the old programs stay in use until
+  // their replacements have linked
+  auto Reload() -> void;
+
+  // deletes all programs, must be called while the GL context is current
+  auto Clear() -> void;
+
+  auto BeginFrame() -> void;
+  // programs compiled from source, binary cache hits are not counted
+  auto CompilesThisFrame() const -> uint32_t;
+  auto TotalCompiles() const -> uint32_t;
+  auto Size() const -> size_t;
+  auto Pending() const -> size_t;
+  auto Binaries() const -> const pdx::ProgramCache&;
+
+private:
+  struct Key {
+    std::string vertFile;
+    std::string fragFile;
+    std::vector<std::string> defines;
+
+    auto operator==(const Key& other) const -> bool = default;
+  };
+
+  struct KeyHash {
+    auto operator()(const Key& key) const -> size_t;
+  };
+
+  struct PendingReload {
+    pdx::shader_handle_t handle;
+    pdx::Shader program;
+  };
+
+  auto Init() -> void;
+
+  std::unordered_map<Key, pdx::shader_handle_t, KeyHash> m_Handles;
+  std::vector<Key> m_Keys;
+  std::vector<pdx::Shader> m_Programs;
+  std::vector<PendingReload> m_Reloads;
+  // unquantized and quantized, and which one each program falls back to
+  std::vector<pdx::Shader> m_Placeholders;
+  std::vector<uint32_t> m_PlaceholderIndices;
+  pdx::ProgramCache m_Binaries;
+  bool m_ParallelCompile = false;
+  uint32_t m_FrameCompiles = 0;
+  uint32_t m_TotalCompiles = 0;
+};
+} // namespace pdx
+
+#endif /*  __HPP_PARADOX_SHADERCACHE__ */
@@ -0,0 +1,38 @@
+#ifndef __HPP_PARADOX_TEXTURE__
+#define __HPP_PARADOX_TEXTURE__
+
+#include <glad/gl.h>
+
+#include <cstddef>
+
+#include "meshdata.hpp"
+
+namespace pdx {
+// Owns a GL texture name, shared between models through the TextureCache
+class Texture {
+public:
+  Texture(GLuint id, size_t bytes);
+  Texture(const Texture&) = delete;
+  ~Texture();
+
+  auto operator=(const Texture&) -> Texture& = delete;
+
+  auto Id() const -> GLuint;
+  // estimated GPU memory including mips
+  auto Bytes() const -> size_t;
+
+private:
+  GLuint m_Id;
+  size_t m_Bytes;
+};
+
+// Creates a 2D texture with the size, format and sampler state of texture.
+// pixels is passed to glTexImage2D as is, so with a pixel unpack buffer bound
+// it is an offset into that buffer. Returns 0 for textures without an image
+auto CreateTexture(const pdx::MeshTexture& texture, const void *pixels)
+    -> GLuint;
+// GPU memory CreateTexture allocates for texture
+auto TextureBytes(const pdx::MeshTexture& texture) -> size_t;
+} // namespace pdx
+
+#endif /*  __HPP_PARADOX_TEXTURE__ */
@@ -0,0 +1,88 @@
+#ifndef __HPP_PARADOX_TEXTURECACHE__
+#define __HPP_PARADOX_TEXTURECACHE__
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include "meshdata.hpp"
+#include "texture.hpp"
+
+namespace pdx {
+// identifies one uploaded image. Sampling state lives in sampler objects, so
+// only the color space decides whether the same image can be shared
+struct TextureKey {
+  // resolved file path, or "#" and a content hash for embedded images
+  std::string source;
+  bool srgb;
+
+  auto operator==(const TextureKey& other) const -> bool = default;
+};
+
+// Process wide cache of uploaded textures. Models hold shared references, a
+// texture is deleted once the last model using it is gone. Find may be called
+// from any thread so loaders can skip decoding images that are resident
+class TextureCache {
+public:
+  static auto Get() -> TextureCache&;
+
+  // file textures are keyed by path relative to baseDir, embedded ones by
+  // hashing their decoded pixels
+  static auto KeyFor(const pdx::MeshTexture& texture,
+                     const std::filesystem::path& baseDir) -> pdx::TextureKey;
+
+  auto Find(const pdx::TextureKey& key) -> std::shared_ptr<pdx::Texture>;
+  // takes ownership of id. If another thread inserted the same key first the
+  // existing texture is returned and id is deleted
+  auto Insert(const pdx::TextureKey& key, GLuint id, size_t bytes)
+      -> std::shared_ptr<pdx::Texture>;
+
+  // the resident texture for key, otherwise uploads texture with upload and
+  // inserts the result. Render thread only
+  template <typename Upload>
+  auto Acquire(const pdx::TextureKey& key, const pdx::MeshTexture& texture,
+               Upload&& upload) -> std::shared_ptr<pdx::Texture> {
+    if (std::shared_ptr<pdx::Texture> resident = Find(key)) {
+      return resident;
+    }
+    GLuint id = upload(texture);
+    if (id == 0) {
+      return nullptr;
+    }
+    return Insert(key, id, pdx::TextureBytes(texture));
+  }
+
+  auto Size() const -> size_t;
+  auto Bytes() const -> size_t;
+  // lookups that found a resident texture
+  auto Hits() const -> uint32_t;
+  auto Uploads() const -> uint32_t;
+
+private:
+  TextureCache() = default;
+
+  struct KeyHash {
+    auto operator()(const pdx::TextureKey& key) const -> size_t;
+  };
+
+  struct Entry {
+    std::weak_ptr<pdx::Texture> texture;
+    // tells an expired entry apart from one that replaced it
+    const pdx::Texture *owner = nullptr;
+  };
+
+  auto Remove(const pdx::TextureKey& key, pdx::Texture *texture) -> void;
+
+  mutable std::mutex m_Mutex;
+  std::unordered_map<pdx::TextureKey, Entry, KeyHash> m_Textures;
+  size_t m_Bytes = 0;
+  uint32_t m_Hits = 0;
+  uint32_t m_Uploads = 0;
+};
+} // namespace pdx
+
+#endif /*  __HPP_PARADOX_TEXTURECACHE__ */
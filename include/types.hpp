@@ -9,8 +9,12 @@ namespace pdx {
 typedef uint32_t vao_t;
 typedef uint32_t vbo_t;
 typedef uint32_t ebo_t;
+typedef uint32_t ubo_t;
 typedef uint32_t program_t;
 typedef uint32_t shader_t;
+typedef uint32_t shader_handle_t;
+typedef uint32_t model_handle_t;
+typedef int32_t uniform_t;
 } // namespace pdx
 
 #endif /*  __HPP_PARADOX_TYPES__ */
@@ -0,0 +1,373 @@
+#include "assetloader.hpp"
+#include "texture.hpp"
+#include "texturecache.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <iostream>
+#include <unordered_set>
+
+using namespace pdx;
+
+AssetLoader::~AssetLoader() { StopWorkers(); }
+
+auto AssetLoader::Start() -> void {
+  if (!m_Workers.empty()) {
+    return;
+  }
+  // decoding is the expensive part, a couple of threads keep the disk busy
+  // without fighting the render thread for cores
+  unsigned count = std::clamp(std::thread::hardware_concurrency() / 2, 1u, 4u);
+  for (unsigned i = 0; i < count; ++i) {
+    m_Workers.emplace_back(&AssetLoader::Worker, this);
+  }
+}
+
+auto AssetLoader::Worker() -> void {
+  while (true) {
+    Job job;
+    {
+      std::unique_lock<std::mutex> lock(m_Mutex);
+      m_Wake.wait(lock, [this] { return m_Stop || !m_Jobs.empty(); });
+      if (m_Stop) {
+        return;
+      }
+      job = std::move(m_Jobs.front());
+      m_Jobs.pop_front();
+    }
+
+    auto asset = pdx::MeshAsset::Load(job.file);
+    if (asset.has_value() && m_Optimize) {
+      asset->Optimize();
+    }
+    if (asset.has_value() && m_Quantize) {
+      size_t saved = asset->Quantize();
+      std::cout << "Quantized vertices: " << job.file.string() << " (saved "
+                << saved / 1024 << " KiB)" << std::endl;
+    }
+
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    m_Finished.push_back(Finished{job.handle, std::move(asset)});
+  }
+}
+
+auto AssetLoader::SetQuantize(bool quantize) -> void {
+  assert(m_Entries.empty());
+  m_Quantize = quantize;
+}
+
+auto AssetLoader::Quantize() const -> bool { return m_Quantize; }
+
+auto AssetLoader::SetOptimize(bool optimize) -> void {
+  assert(m_Entries.empty());
+  m_Optimize = optimize;
+}
+
+auto AssetLoader::SetBudget(size_t cpuBytes, size_t gpuBytes) -> void {
+  m_CpuBudget = cpuBytes;
+  m_GpuBudget = gpuBytes;
+}
+
+auto AssetLoader::Load(const std::filesystem::path& file)
+    -> pdx::model_handle_t {
+  std::string key = file.lexically_normal().string();
+  auto it = m_Handles.find(key);
+  if (it != m_Handles.end()) {
+    return it->second;
+  }
+
+  auto handle = static_cast<pdx::model_handle_t>(m_Entries.size());
+  m_Entries.push_back(Entry{file, State::LOADING, {}, m_Frame});
+  m_Handles.emplace(key, handle);
+  Queue(handle);
+  return handle;
+}
+
+auto AssetLoader::Queue(pdx::model_handle_t handle) -> void {
+  Start();
+  {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    m_Jobs.push_back(Job{handle, m_Entries[handle].file});
+  }
+  m_Wake.notify_one();
+}
+
+auto AssetLoader::Get(pdx::model_handle_t handle) const -> const pdx::Model * {
+  if (handle >= m_Entries.size()) {
+    return nullptr;
+  }
+  const Entry& entry = m_Entries[handle];
+  entry.lastUsed = m_Frame;
+  if (entry.state == State::EVICTED) {
+    entry.requested = true;
+  }
+  if (entry.state != State::READY) {
+    return nullptr;
+  }
+  return &*entry.model;
+}
+
+auto AssetLoader::Peek(pdx::model_handle_t handle) const
+    -> const pdx::Model * {
+  if (handle >= m_Entries.size() ||
+      m_Entries[handle].state != State::READY) {
+    return nullptr;
+  }
+  return &*m_Entries[handle].model;
+}
+
+auto AssetLoader::Failed(pdx::model_handle_t handle) const -> bool {
+  return handle < m_Entries.size() &&
+         m_Entries[handle].state == State::FAILED;
+}
+
+auto AssetLoader::File(pdx::model_handle_t handle) const
+    -> const std::filesystem::path& {
+  return m_Entries[handle].file;
+}
+
+auto AssetLoader::Poll(size_t budgetBytes) -> void {
+  m_UploadedThisFrame = 0;
+  m_EvictionsThisFrame = 0;
+  ++m_Frame;
+
+  for (size_t i = 0; i < m_Entries.size(); ++i) {
+    Entry& entry = m_Entries[i];
+    if (entry.state == State::EVICTED && entry.requested) {
+      entry.state = State::LOADING;
+      entry.requested = false;
+      Queue(static_cast<pdx::model_handle_t>(i));
+      ++m_Reloads;
+    }
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    while (!m_Finished.empty()) {
+      Finished finished = std::move(m_Finished.front());
+      m_Finished.pop_front();
+      if (!finished.asset.has_value()) {
+        std::cout << "Failed to load model: "
+                  << m_Entries[finished.handle].file.string() << std::endl;
+        m_Entries[finished.handle].state = State::FAILED;
+        continue;
+      }
+      m_Uploads.push_back(
+          Upload{finished.handle, std::move(*finished.asset), {}, 0});
+    }
+  }
+
+  while (!m_Uploads.empty()) {
+    Upload& upload = m_Uploads.front();
+    if (m_UploadedThisFrame > 0 &&
+        m_UploadedThisFrame + NextStepSize(upload) > budgetBytes) {
+      break;
+    }
+    m_UploadedThisFrame += Step(upload);
+
+    if (upload.model.has_value() &&
+        upload.nextTexture == upload.asset.textures.size()) {
+      Entry& entry = m_Entries[upload.handle];
+      entry.model = std::move(upload.model);
+      entry.state = State::READY;
+      // not evicted before anyone had a chance to use it
+      entry.lastUsed = m_Frame;
+      m_Uploads.pop_front();
+    }
+  }
+
+  Measure();
+  EnforceBudget();
+}
+
+static auto AssetBytes(const pdx::MeshAsset& asset) -> size_t {
+  pdx::MeshView view = asset.View();
+  size_t bytes = view.vertices.size_bytes() +
+                 view.quantizedVertices.size_bytes() +
+                 view.indices.size_bytes();
+  for (const pdx::MeshTexture& texture : asset.textures) {
+    bytes += texture.pixels.size();
+  }
+  return bytes;
+}
+
+auto AssetLoader::Measure() -> void {
+  m_CpuBytes = 0;
+  m_GpuBytes = 0;
+  // textures shared between models are only counted once
+  std::unordered_set<const pdx::Texture *> textures;
+  auto add = [&](const pdx::Model& model) {
+    pdx::ModelMemory memory = model.Memory();
+    m_CpuBytes += memory.cpu;
+    m_GpuBytes += memory.geometry;
+    for (const auto& texture : model.Textures()) {
+      if (texture != nullptr && textures.insert(texture.get()).second) {
+        m_GpuBytes += texture->Bytes();
+      }
+    }
+  };
+  for (const Entry& entry : m_Entries) {
+    if (entry.model.has_value()) {
+      add(*entry.model);
+    }
+  }
+  for (const Upload& upload : m_Uploads) {
+    m_CpuBytes += AssetBytes(upload.asset);
+    if (upload.model.has_value()) {
+      add(*upload.model);
+    }
+  }
+}
+
+auto AssetLoader::EnforceBudget() -> void {
+  while (m_CpuBytes > m_CpuBudget || m_GpuBytes > m_GpuBudget) {
+    Entry *victim = nullptr;
+    for (Entry& entry : m_Entries) {
+      if (entry.state == State::READY &&
+          m_Frame - entry.lastUsed >= MIN_IDLE_FRAMES &&
+          (victim == nullptr || entry.lastUsed < victim->lastUsed)) {
+        victim = &entry;
+      }
+    }
+    // everything left is in use, the pressure shows up in Residency
+    if (victim == nullptr) {
+      return;
+    }
+    std::cout << "Evicted model: " << victim->file.string() << std::endl;
+    // drops the geometry range and the texture references
+    victim->model.reset();
+    victim->state = State::EVICTED;
+    victim->requested = false;
+    ++m_Evictions;
+    ++m_EvictionsThisFrame;
+    Measure();
+  }
+}
+
+auto AssetLoader::NextStepSize(const Upload& upload) const -> size_t {
+  if (!upload.model.has_value()) {
+    pdx::MeshView view = upload.asset.View();
+    return view.vertices.size_bytes() + view.quantizedVertices.size_bytes() +
+           view.indices.size_bytes();
+  }
+  if (upload.asset.residentTextures[upload.nextTexture] != nullptr) {
+    return 0;
+  }
+  return upload.asset.textures[upload.nextTexture].pixels.size();
+}
+
+auto AssetLoader::Step(Upload& upload) -> size_t {
+  size_t bytes = NextStepSize(upload);
+  if (!upload.model.has_value()) {
+    pdx::MeshView view = upload.asset.View();
+    upload.model = pdx::Model::FromGeometry(view);
+    m_QuantizationSaved += view.quantizedVertices.size() *
+                           (sizeof(pdx::Vertex) - sizeof(pdx::QuantizedVertex));
+    upload.asset.ReleaseGeometry();
+    return bytes;
+  }
+  size_t index = upload.nextTexture++;
+  std::shared_ptr<pdx::Texture> texture = upload.asset.residentTextures[index];
+  if (texture == nullptr) {
+    bool uploaded = false;
+    texture = pdx::TextureCache::Get().Acquire(
+        upload.asset.textureKeys[index], upload.asset.textures[index],
+        [&](const pdx::MeshTexture& texture) {
+          uploaded = true;
+          return UploadTexture(texture);
+        });
+    // another model uploaded the same image since this one was decoded
+    if (!uploaded) {
+      bytes = 0;
+    }
+  }
+  upload.model->SetTexture(index, std::move(texture));
+  // the pixels are on the GPU now, no reason to hold on to them
+  std::vector<uint8_t>().swap(upload.asset.textures[index].pixels);
+  return bytes;
+}
+
+auto AssetLoader::UploadTexture(const pdx::MeshTexture& texture) -> GLuint {
+  size_t size = texture.pixels.size();
+  if (size == 0) {
+    return pdx::CreateTexture(texture, nullptr);
+  }
+
+  if (m_Staging == 0) {
+    glGenBuffers(1, &m_Staging);
+  }
+  // orphaning hands the previous contents to the driver, so the copy below
+  // never waits for an earlier transfer to finish
+  glBindBuffer(GL_PIXEL_UNPACK_BUFFER, m_Staging);
+  glBufferData(GL_PIXEL_UNPACK_BUFFER, size, nullptr, GL_STREAM_DRAW);
+  void *staging = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, size,
+                                   GL_MAP_WRITE_BIT |
+                                       GL_MAP_INVALIDATE_BUFFER_BIT);
+  GLuint result;
+  if (staging != nullptr) {
+    memcpy(staging, texture.pixels.data(), size);
+    glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+    result = pdx::CreateTexture(texture, nullptr);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+  } else {
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    result = pdx::CreateTexture(texture, texture.pixels.data());
+  }
+  return result;
+}
+
+auto AssetLoader::StopWorkers() -> void {
+  {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    m_Stop = true;
+    m_Jobs.clear();
+  }
+  m_Wake.notify_all();
+  for (auto& worker : m_Workers) {
+    worker.join();
+  }
+  m_Workers.clear();
+}
+
+auto AssetLoader::Shutdown() -> void {
+  StopWorkers();
+
+  if (m_Staging != 0) {
+    glDeleteBuffers(1, &m_Staging);
+    m_Staging = 0;
+  }
+  m_Uploads.clear();
+  m_Finished.clear();
+  // drops the texture references while the context is still current
+  m_Entries.clear();
+  m_Handles.clear();
+}
+
+auto AssetLoader::Size() const -> size_t { return m_Entries.size(); }
+
+auto AssetLoader::Pending() const -> size_t {
+  return std::count_if(m_Entries.begin(), m_Entries.end(),
+                       [](const Entry& entry) {
+                         return entry.state == State::LOADING;
+                       });
+}
+
+auto AssetLoader::UploadedThisFrame() const -> size_t {
+  return m_UploadedThisFrame;
+}
+
+auto AssetLoader::QuantizationSavedBytes() const -> size_t {
+  return m_QuantizationSaved;
+}
+
+auto AssetLoader::Residency() const -> pdx::ResidencyStats {
+  pdx::ResidencyStats stats{m_CpuBytes,  m_GpuBytes, m_CpuBudget,
+                            m_GpuBudget, 0,          0,
+                            m_Evictions, m_Reloads,  m_EvictionsThisFrame};
+  for (const Entry& entry : m_Entries) {
+    stats.resident += entry.state == State::READY;
+    stats.evicted += entry.state == State::EVICTED;
+  }
+  return stats;
+}
@@ -0,0 +1,77 @@
+#include "camerabuffer.hpp"
+
+#include <cassert>
+
+using namespace pdx;
+
+auto CameraBuffer::Create(uint32_t capacity) -> void {
+  GLint alignment = 256;
+  glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+  m_Stride = (sizeof(CameraBlock) + alignment - 1) / alignment * alignment;
+  m_Capacity = capacity;
+  m_Count = 0;
+
+  glGenBuffers(1, &m_Buffer);
+  glBindBuffer(GL_UNIFORM_BUFFER, m_Buffer);
+  glBufferData(GL_UNIFORM_BUFFER, m_Stride * m_Capacity, nullptr,
+               GL_DYNAMIC_DRAW);
+  glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
+
+auto CameraBuffer::Destroy() -> void {
+  if (m_Buffer != 0) {
+    glDeleteBuffers(1, &m_Buffer);
+    m_Buffer = 0;
+  }
+}
+
+auto CameraBuffer::BeginFrame() -> void {
+  m_Count = 0;
+  // orphan last frame's storage so the driver does not have to wait for it
+  glBindBuffer(GL_UNIFORM_BUFFER, m_Buffer);
+  glBufferData(GL_UNIFORM_BUFFER, m_Stride * m_Capacity, nullptr,
+               GL_DYNAMIC_DRAW);
+  glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
+
+auto CameraBuffer::Push(const glm::mat4& view, const glm::mat4& projection,
+                        const glm::vec4& clipPlane) -> uint32_t {
+  if (m_Count == m_Capacity) {
+    Grow();
+  }
+
+  CameraBlock block{view, projection, projection * view, clipPlane};
+  uint32_t slot = m_Count++;
+  glBindBuffer(GL_UNIFORM_BUFFER, m_Buffer);
+  glBufferSubData(GL_UNIFORM_BUFFER, m_Stride * slot, sizeof(CameraBlock),
+                  &block);
+  glBindBuffer(GL_UNIFORM_BUFFER, 0);
+  Bind(slot);
+  return slot;
+}
+
+auto CameraBuffer::Bind(uint32_t slot) const -> void {
+  assert(slot < m_Count);
+  glBindBufferRange(GL_UNIFORM_BUFFER, CAMERA_BLOCK_BINDING, m_Buffer,
+                    m_Stride * slot, sizeof(CameraBlock));
+}
+
+auto CameraBuffer::ViewsThisFrame() const -> uint32_t { return m_Count; }
+
+auto CameraBuffer::Grow() -> void {
+  // views written earlier this frame may still be rebound, so carry them over
+  pdx::ubo_t buffer;
+  uint32_t capacity = m_Capacity * 2;
+  glGenBuffers(1, &buffer);
+  glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+  glBufferData(GL_COPY_WRITE_BUFFER, m_Stride * capacity, nullptr,
+               GL_DYNAMIC_DRAW);
+  glBindBuffer(GL_COPY_READ_BUFFER, m_Buffer);
+  glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0,
+                      m_Stride * m_Count);
+  glBindBuffer(GL_COPY_READ_BUFFER, 0);
+  glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+  glDeleteBuffers(1, &m_Buffer);
+  m_Buffer = buffer;
+  m_Capacity = capacity;
+}
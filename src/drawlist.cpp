@@ -0,0 +1,198 @@
+#include "drawlist.hpp"
+#include "geometryarena.hpp"
+#include "glextensions.hpp"
+
+#include <algorithm>
+
+#define BUFFER_OFFSET(i) ((char *)NULL + (i))
+
+using namespace pdx;
+
+template <typename T>
+static auto UploadStream(GLuint& buffer, const std::vector<T>& data) -> void {
+  if (buffer == 0) {
+    glGenBuffers(1, &buffer);
+  }
+  // orphans last frame's storage, the copy binding point leaves everything
+  // else bound untouched
+  glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+  glBufferData(GL_COPY_WRITE_BUFFER, data.size() * sizeof(T), data.data(),
+               GL_STREAM_DRAW);
+  glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+}
+
+auto DrawList::Destroy() -> void {
+  if (m_CommandBuffer != 0) {
+    glDeleteBuffers(1, &m_CommandBuffer);
+    m_CommandBuffer = 0;
+  }
+  if (m_TransformBuffer != 0) {
+    glDeleteBuffers(1, &m_TransformBuffer);
+    m_TransformBuffer = 0;
+  }
+  Clear();
+}
+
+auto DrawList::Clear() -> void {
+  m_PreviousItems.swap(m_Items);
+  m_PreviousTransforms.swap(m_Transforms);
+  m_Items.clear();
+  m_Transforms.clear();
+  m_Commands.clear();
+  m_CommandPackets.clear();
+  m_CommandLevels.clear();
+  m_Batches.clear();
+  m_LastTriangles = m_Triangles;
+  m_LastFullDetailTriangles = m_FullDetailTriangles;
+  m_Triangles = 0;
+  m_FullDetailTriangles = 0;
+}
+
+auto DrawList::Add(const pdx::Model& model, const glm::mat4& transform,
+                   int node) -> void {
+  m_Items.push_back(Item{&model, node});
+  m_Transforms.push_back(transform);
+}
+
+auto DrawList::Upload() -> void {
+  m_Changed = m_Items != m_PreviousItems ||
+              m_Transforms != m_PreviousTransforms;
+  m_Commands.clear();
+  m_CommandPackets.clear();
+  m_CommandLevels.clear();
+  m_Batches.clear();
+  if (!UseMultiDraw()) {
+    return;
+  }
+
+  // batches keep the order in which their model was first added
+  struct Record {
+    uint32_t batch;
+    pdx::DrawElementsIndirectCommand command;
+    const pdx::DrawPacket *packet;
+  };
+  std::vector<Record> records;
+  for (uint32_t i = 0; i < m_Items.size(); ++i) {
+    const Item& item = m_Items[i];
+    for (const pdx::DrawPacket& packet : item.model->Packets(item.node)) {
+      auto batch = std::find_if(
+          m_Batches.begin(), m_Batches.end(), [&](const Batch& other) {
+            return other.model == item.model && other.mode == packet.mode;
+          });
+      if (batch == m_Batches.end()) {
+        batch = m_Batches.insert(batch, Batch{item.model, packet.mode, 0, 0});
+      }
+      records.push_back(Record{
+          static_cast<uint32_t>(batch - m_Batches.begin()),
+          pdx::DrawElementsIndirectCommand{
+              (uint32_t)packet.indexCount, 1,
+              (uint32_t)(packet.indexOffset / sizeof(uint32_t)),
+              packet.baseVertex, i},
+          &packet});
+      ++batch->count;
+    }
+  }
+  std::stable_sort(records.begin(), records.end(),
+                   [](const Record& a, const Record& b) {
+                     return a.batch < b.batch;
+                   });
+
+  uint32_t first = 0;
+  for (Batch& batch : m_Batches) {
+    batch.first = first;
+    first += batch.count;
+  }
+  m_Commands.reserve(records.size());
+  for (const Record& record : records) {
+    m_Commands.push_back(record.command);
+    m_CommandPackets.push_back(record.packet);
+  }
+  // no level matches, so the first Submit writes the command buffer
+  m_CommandLevels.assign(m_Commands.size(), UINT32_MAX);
+
+  UploadStream(m_TransformBuffer, m_Transforms);
+}
+
+auto DrawList::Submit(const pdx::Shader& multiDraw, bool multiDrawReady,
+                      const pdx::Shader& single, const pdx::LodView& lod)
+    -> void {
+  if (!multiDrawReady || !UseMultiDraw()) {
+    single.Use();
+    for (size_t i = 0; i < m_Items.size(); ++i) {
+      const Item& item = m_Items[i];
+      single.SetMat4fv("model", m_Transforms[i]);
+      m_Triangles += item.model->DrawLod(item.node, m_Transforms[i], lod) / 3;
+      for (const pdx::DrawPacket& packet : item.model->Packets(item.node)) {
+        m_FullDetailTriangles += packet.indexCount / 3;
+      }
+    }
+    return;
+  }
+
+  bool changed = false;
+  for (size_t i = 0; i < m_Commands.size(); ++i) {
+    pdx::DrawElementsIndirectCommand& command = m_Commands[i];
+    const pdx::DrawPacket& packet = *m_CommandPackets[i];
+    const pdx::Model& model = *m_Items[command.baseInstance].model;
+    uint32_t level =
+        model.SelectLod(packet, m_Transforms[command.baseInstance], lod);
+    if (level != m_CommandLevels[i]) {
+      pdx::LodRange range = model.Lod(packet, level);
+      command.count = (uint32_t)range.indexCount;
+      command.firstIndex = (uint32_t)(range.indexOffset / sizeof(uint32_t));
+      m_CommandLevels[i] = level;
+      changed = true;
+    }
+    m_Triangles += command.count / 3;
+    m_FullDetailTriangles += packet.indexCount / 3;
+  }
+  if (changed) {
+    // orphans the storage earlier views of this frame still draw from
+    UploadStream(m_CommandBuffer, m_Commands);
+  }
+
+  multiDraw.Use();
+  glBindBufferBase(GL_SHADER_STORAGE_BUFFER, DRAW_TRANSFORM_BINDING,
+                   m_TransformBuffer);
+  glBindBuffer(GL_DRAW_INDIRECT_BUFFER, m_CommandBuffer);
+  for (const Batch& batch : m_Batches) {
+    if (!batch.model->BindGeometry()) {
+      continue;
+    }
+    batch.model->BindTextures();
+    glMultiDrawElementsIndirect(
+        batch.mode, GL_UNSIGNED_INT,
+        BUFFER_OFFSET(batch.first * sizeof(DrawElementsIndirectCommand)),
+        batch.count, 0);
+  }
+  glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+}
+
+auto DrawList::Draws() const -> size_t {
+  if (!UseMultiDraw()) {
+    size_t draws = 0;
+    for (const Item& item : m_Items) {
+      draws += item.model->Packets(item.node).size();
+    }
+    return draws;
+  }
+  return m_Commands.size();
+}
+
+auto DrawList::Calls() const -> size_t {
+  return UseMultiDraw() ? m_Batches.size() : Draws();
+}
+
+auto DrawList::Triangles() const -> size_t { return m_LastTriangles; }
+
+auto DrawList::FullDetailTriangles() const -> size_t {
+  return m_LastFullDetailTriangles;
+}
+
+auto DrawList::Changed() const -> bool { return m_Changed; }
+
+auto DrawList::UseMultiDraw() const -> bool {
+  // every transform needs its own draw id
+  return GLExtensions::Get().multiDrawIndirect &&
+         m_Transforms.size() <= GeometryArena::MAX_DRAW_IDS;
+}
@@ -11,13 +11,20 @@
 
 #include <glm/matrix.hpp>
 #include <glm/trigonometric.hpp>
+#include <cmath>
 #include <iostream>
 
 #include "assetdir.hpp"
 #include "camera.hpp"
+#include "geometryarena.hpp"
+#include "glextensions.hpp"
+#include "glstate.hpp"
+#include "instancestream.hpp"
 #include "model.hpp"
 #include "portal.hpp"
+#include "samplercache.hpp"
 #include "shader.hpp"
+#include "texturecache.hpp"
 
 #define STB_IMAGE_IMPLEMENTATION
 #include <external/stb_image.h>
@@ -28,6 +35,26 @@
 
 using namespace pdx;
 
+// store model vertices as pdx::QuantizedVertex, 24 instead of 56 bytes each
+constexpr bool QUANTIZE_VERTICES = true;
+// reorder models without a cooked .pdxmesh at load time, pdxcook always does
+constexpr bool OPTIMIZE_MESHES = true;
+// screen space error a model LOD may show, in pixels
+constexpr float LOD_MAX_ERROR_PIXELS = 1.0f;
+// extra LOD levels for every portal a view is seen through
+constexpr uint32_t LOD_BIAS_PER_PORTAL = 1;
+// models unused for a couple of frames are evicted above these
+constexpr size_t ASSET_CPU_BUDGET = 256 * 1024 * 1024;
+constexpr size_t ASSET_GPU_BUDGET = 1024 * 1024 * 1024;
+// portal recursion depth, only the starting point when it is adaptive
+constexpr uint32_t MAX_RECURSION_LIMIT = 3;
+// steer depth and recursing views per frame to the target GPU frame time
+constexpr bool ADAPTIVE_PORTAL_DEPTH = true;
+constexpr float PORTAL_TARGET_FRAME_MS = 1000.0f / 60.0f;
+// draw every portal's view into a texture once per frame instead of
+// recursing with the stencil buffer, deeper levels show last frame's images
+constexpr bool PORTAL_RENDER_TARGETS = false;
+
 static auto GLAPIENTRY glDebugOutput(GLenum source, GLenum type,
                                      unsigned int id, GLenum severity,
                                      GLsizei length, const char *message,
@@ -138,6 +165,7 @@ Game::Game(const std::string& title, int screenWidth, int screenHeight) {
   if (!gladLoaderLoadGL()) {
     std::cout << "Failed to initialize GLAD" << std::endl;
   }
+  pdx::GLExtensions::Load();
 
   SDL_SetRelativeMouseMode(SDL_TRUE);
   SDL_GL_SetSwapInterval(1);
@@ -171,29 +199,54 @@ auto Game::Run() -> void {
   Camera camera(glm::vec3(0.0f, 0.0f, 1.0f), glm::vec3(0.0f, 1.0f, 0.0f),
                 glm::vec3(0.0f, 0.0f, -1.0f));
 
+  m_Assets.SetQuantize(QUANTIZE_VERTICES);
+  m_Assets.SetOptimize(OPTIMIZE_MESHES);
+  m_Assets.SetBudget(ASSET_CPU_BUDGET, ASSET_GPU_BUDGET);
+
   pdx::AssetDir cubeDir{"data", "models", "cube"};
-  pdx::Model cube = pdx::Model::FromGLTF(cubeDir.GetFile("scene.gltf")).value();
+  m_Cube = m_Assets.Load(cubeDir.GetFile("scene.gltf"));
 
   pdx::AssetDir floorDir{"data", "models", "floor"};
-  pdx::Model floor =
-      pdx::Model::FromGLTF(floorDir.GetFile("scene.gltf")).value();
+  m_Floor = m_Assets.Load(floorDir.GetFile("scene.gltf"));
 
   glm::vec3 cubePosition(0.0f, 0.0f, 0.0f);
   pdx::Portal portalA(pdx::Camera(glm::vec3(0.0f, 0.0f, 4.0f),
                                   glm::vec3(0.0f, 1.0f, 0.0f),
-                                  glm::vec3(0.0f, 0.0f, -1.0f)));
+                                  glm::vec3(0.0f, 0.0f, -1.0f)),
+                      m_Assets);
   portalA.AddAngle(180.0f, glm::vec3(0.0f, 1.0f, 0.0f));
   pdx::Portal portalB(pdx::Camera(glm::vec3(0.0f, 0.0f, -4.0f),
                                   glm::vec3(0.0f, 1.0f, 0.0f),
-                                  glm::vec3(0.0f, 0.0f, 1.0f)));
-
-  portalA.SetDestination(&portalB);
-  portalB.SetDestination(&portalA);
+                                  glm::vec3(0.0f, 0.0f, 1.0f)),
+                      m_Assets);
 
   m_Portals.push_back(portalA);
   m_Portals.push_back(portalB);
-  m_Models.push_back(floor);
-  m_Models.push_back(cube);
+  // the copies in m_Portals link to each other, so a destination's index
+  // is its offset in there
+  m_Portals[0].SetDestination(&m_Portals[1]);
+  m_Portals[1].SetDestination(&m_Portals[0]);
+
+  // every program has to match the vertex format the models are stored in
+  auto defines = [&](std::vector<std::string> defines) {
+    if (m_Assets.Quantize()) {
+      defines.push_back("QUANTIZED");
+    }
+    return defines;
+  };
+  m_SimpleShader = m_Shaders.Load("simple.vert", "simple.frag", defines({}));
+  m_SimpleMultiDrawShader = m_Shaders.Load("simple.vert", "simple.frag",
+                                           defines({"MULTI_DRAW"}));
+  m_SingleColorShader =
+      m_Shaders.Load("singleColor.vert", "singleColor.frag", defines({}));
+  m_SingleColorInstancedShader = m_Shaders.Load(
+      "singleColor.vert", "singleColor.frag", defines({"INSTANCED"}));
+  m_PortalViewShader = m_Shaders.Load("singleColor.vert", "portalView.frag",
+                                      defines({"PORTAL_VIEW"}));
+  m_CameraBuffer.Create();
+  m_PortalBudget.Create(PORTAL_TARGET_FRAME_MS, MAX_RECURSION_LIMIT,
+                        ADAPTIVE_PORTAL_DEPTH);
+  m_UsePortalTargets = PORTAL_RENDER_TARGETS;
 
   int now = SDL_GetPerformanceCounter();
   int last = 0;
@@ -212,6 +265,11 @@ auto Game::Run() -> void {
 
     delta = (double)(now - last) / (double)SDL_GetPerformanceFrequency();
 
+    m_Shaders.BeginFrame();
+    m_CameraBuffer.BeginFrame();
+    pdx::GLState::Get().BeginFrame();
+    pdx::InstanceStream::Get().BeginFrame();
+
     for (const auto& portal : m_Portals) {
       if (glm::dot(camera.Front(), portal.Front()) < 0.0f) {
         // n = normal of plane
@@ -282,8 +340,16 @@ auto Game::Run() -> void {
     SDL_Event event;
     while (SDL_PollEvent(&event)) {
       ImGui_ImplSDL2_ProcessEvent(&event);
+      if (event.type == SDL_KEYDOWN && !event.key.repeat &&
+          event.key.keysym.scancode == SDL_SCANCODE_F5) {
+        m_Shaders.Reload();
+      }
     }
 
+    m_Shaders.Poll();
+    m_Assets.Poll();
+    BuildLevel();
+
     ImGui_ImplOpenGL3_NewFrame();
     ImGui_ImplSDL2_NewFrame();
     ImGui::NewFrame();
@@ -301,19 +367,125 @@ auto Game::Run() -> void {
 #endif
       }
       frameStart = SDL_GetTicks64();
+      ImGui::Text("Programs: %zu (%zu pending)", m_Shaders.Size(),
+                  m_Shaders.Pending());
+      ImGui::Text("Shader compiles: %u (total %u)",
+                  m_Shaders.CompilesThisFrame(), m_Shaders.TotalCompiles());
+      ImGui::Text("Program binaries: %u hits, %u misses",
+                  m_Shaders.Binaries().Hits(), m_Shaders.Binaries().Misses());
+      ImGui::Text("Models: %zu (%zu pending), %zu KiB uploaded",
+                  m_Assets.Size(), m_Assets.Pending(),
+                  m_Assets.UploadedThisFrame() / 1024);
+      ImGui::Text("Portal views: %u drawn (%.0f%% of the screen), %u culled",
+                  m_PortalViews, m_PortalViewArea * 100.0f,
+                  m_CulledPortalViews);
+      pdx::PortalBudgetStats budget = m_PortalBudget.Stats();
+      ImGui::Text("Portal depth: %u, %u recursing views (budget %u)",
+                  budget.depth, budget.recursedViews, budget.viewBudget);
+      ImGui::Text("GPU frame: %.2f ms (target %.2f ms)", budget.frameMs,
+                  budget.targetMs);
+      if (m_PortalBudget.Adaptive() &&
+          ImGui::SliderFloat("Target frame", &budget.targetMs, 4.0f, 50.0f,
+                             "%.1f ms")) {
+        m_PortalBudget.SetTarget(budget.targetMs);
+      }
+      ImGui::Checkbox("Portal render targets", &m_UsePortalTargets);
+      if (m_UsePortalTargets) {
+        ImGui::Text("Portal images: %u drawn, %u cached",
+                    m_PortalTargets.Drawn(), m_PortalTargets.Cached());
+      }
+      if (ImGui::CollapsingHeader("Portal levels")) {
+        for (uint32_t level = 0; level <= budget.depth + 1; ++level) {
+          ImGui::Text("%u: %.1f views, %.3f ms", level,
+                      budget.levelViews[level], budget.levelMs[level]);
+        }
+      }
+      ImGui::Text("Level: %zu draws in %zu calls", m_LevelDraws.Draws(),
+                  m_LevelDraws.Calls());
+      ImGui::Text("Level triangles: %zu (%zu at full detail)",
+                  m_LevelDraws.Triangles(),
+                  m_LevelDraws.FullDetailTriangles());
+      pdx::ResidencyStats residency = m_Assets.Residency();
+      ImGui::Text("Residency: CPU %zu / %zu MiB, GPU %zu / %zu MiB",
+                  residency.cpuBytes >> 20, residency.cpuBudget >> 20,
+                  residency.gpuBytes >> 20, residency.gpuBudget >> 20);
+      ImGui::Text("Evicted: %u (%u evictions, %u this frame, %u reloads)",
+                  residency.evicted, residency.evictions,
+                  residency.evictionsThisFrame, residency.reloads);
+      ImGui::Text("Quantization saved %zu KiB",
+                  m_Assets.QuantizationSavedBytes() / 1024);
+      ImGui::Text("Instances: %u",
+                  pdx::InstanceStream::Get().InstancesThisFrame());
+      pdx::GeometryArena& geometry = pdx::GeometryArena::Get();
+      ImGui::Text("Geometry: %zu / %zu KiB in %zu pages",
+                  geometry.UsedBytes() / 1024, geometry.CapacityBytes() / 1024,
+                  geometry.Pages());
+      pdx::TextureCache& textures = pdx::TextureCache::Get();
+      ImGui::Text("Textures: %zu (%zu KiB), %u uploads, %u shared",
+                  textures.Size(), textures.Bytes() / 1024,
+                  textures.Uploads(), textures.Hits());
+      float maxAnisotropy = pdx::GLExtensions::Get().maxAnisotropy;
+      if (maxAnisotropy > 0.0f) {
+        float anisotropy = pdx::SamplerCache::Get().Anisotropy();
+        if (ImGui::SliderFloat("Anisotropy", &anisotropy, 1.0f,
+                               maxAnisotropy, "%.0fx")) {
+          pdx::SamplerCache::Get().SetAnisotropy(anisotropy);
+        }
+      }
+      ImGui::Text("GL state: %u issued, %u filtered",
+                  pdx::GLState::Get().LastIssued(),
+                  pdx::GLState::Get().LastFiltered());
+      if (ImGui::CollapsingHeader("Resident memory")) {
+        for (pdx::model_handle_t handle = 0; handle < m_Assets.Size();
+             ++handle) {
+          // Get would keep every model resident while the header is open
+          const pdx::Model *model = m_Assets.Peek(handle);
+          if (model == nullptr) {
+            continue;
+          }
+          pdx::ModelMemory memory = model->Memory();
+          ImGui::Text("%s: %zu KiB CPU, %zu KiB geometry, %zu KiB textures",
+                      m_Assets.File(handle).generic_string().c_str(),
+                      memory.cpu / 1024, memory.geometry / 1024,
+                      memory.textures / 1024);
+        }
+      }
       ImGui::End();
     }
 
+    m_PortalBudget.BeginFrame();
     glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
 
-    DrawPortals(camera.GetViewMatrix(), projection, 0);
+    m_PortalViews = 0;
+    m_CulledPortalViews = 0;
+    m_PortalViewArea = 0.0f;
+    if (m_UsePortalTargets && m_Shaders.IsReady(m_PortalViewShader)) {
+      DrawPortalTargets(camera.GetViewMatrix(), projection);
+    } else {
+      DrawPortals(camera.GetViewMatrix(), projection, glm::vec4(0.0f), 0,
+                  glm::vec4(-1.0f, -1.0f, 1.0f, 1.0f));
+    }
+    // the clear at the start of the next frame has to reach every pixel
+    pdx::GLState::Get().Disable(GL_SCISSOR_TEST);
+    m_PortalBudget.Mark(pdx::PortalBudget::NO_LEVEL);
 
     ImGui::Render();
     ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+    m_PortalBudget.EndFrame();
     SDL_GL_SwapWindow(m_Window);
   } while (running);
 
+  m_Shaders.Clear();
+  m_CameraBuffer.Destroy();
+  m_PortalBudget.Destroy();
+  m_PortalTargets.Destroy();
+  m_LevelDraws.Destroy();
+  m_Assets.Shutdown();
+  pdx::GeometryArena::Get().Clear();
+  pdx::InstanceStream::Get().Clear();
+  pdx::SamplerCache::Get().Clear();
+
   ImGui_ImplOpenGL3_Shutdown();
   ImGui_ImplSDL2_Shutdown();
   ImGui::DestroyContext();
@@ -323,116 +495,262 @@ auto Game::Run() -> void {
   SDL_Quit();
 }
 
-constexpr uint32_t MAX_RECURSION_LIMIT = 3;
-
 auto Game::DrawPortals(const glm::mat4& view, const glm::mat4& projection,
-                       uint32_t recursionLevel) const -> void {
-  pdx::Shader simpleShader("simple.vert", "simple.frag");
-  pdx::Shader singleColorShader("singleColor.vert", "singleColor.frag");
-
-  glEnable(GL_CULL_FACE);
-  glCullFace(GL_BACK);
+                       const glm::vec4& clipPlane, uint32_t recursionLevel,
+                       const glm::vec4& screenRect) -> void {
+  const pdx::Shader& singleColorShader = m_Shaders.Get(m_SingleColorShader);
+  uint32_t viewSlot = m_CameraBuffer.Push(view, projection, clipPlane);
+  pdx::GLState& state = pdx::GLState::Get();
+  const glm::mat4 viewProj = projection * view;
+
+  state.Enable(GL_CULL_FACE);
+  state.CullFace(GL_BACK);
+  // everything this view draws or clears, its stencil marks included, lies
+  // inside the portal it is seen through
+  Scissor(screenRect);
+  m_PortalBudget.Mark(recursionLevel);
 
   for (const auto& portal : m_Portals) {
+    // a portal outside this view, or outside the portal it is seen through,
+    // cannot show anything, so neither its stencil passes nor the views
+    // behind it are drawn
+    std::optional<glm::vec4> rect = portal.ScreenRect(viewProj, screenRect);
+    if (!rect.has_value()) {
+      ++m_CulledPortalViews;
+      continue;
+    }
+    ++m_PortalViews;
+    m_PortalViewArea += (rect->z - rect->x) * (rect->w - rect->y) * 0.25f;
+
     // disable depth and color masks
-    glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
-    glDepthMask(GL_FALSE);
+    state.ColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+    state.DepthMask(GL_FALSE);
     // disable depth test
-    glDisable(GL_DEPTH_TEST);
+    state.Disable(GL_DEPTH_TEST);
     // enable stencil test
-    glEnable(GL_STENCIL_TEST);
+    state.Enable(GL_STENCIL_TEST);
     // always fail
-    glStencilFuncSeparate(GL_FRONT, GL_NOTEQUAL, recursionLevel, 0xFF);
+    state.StencilFuncSeparate(GL_FRONT, GL_NOTEQUAL, recursionLevel, 0xFF);
     // replace passing tests with 1
-    glStencilOpSeparate(GL_FRONT, GL_INCR, GL_KEEP, GL_KEEP);
-    glStencilMaskSeparate(GL_FRONT, 0xFF);
-
-    portal.DrawPortalPlane(view, projection, singleColorShader);
-
-    glm::mat4 destView =
-        view * portal.ModelMatrix() *
-        glm::rotate(glm::mat4(1.0f), glm::radians(180.0f),
-                    glm::vec3(0.0f, 1.0f, 0.0f) *
-                        portal.GetDestination()->Orientation()) *
-        glm::inverse(portal.GetDestination()->ModelMatrix());
-    if (recursionLevel == MAX_RECURSION_LIMIT) {
+    state.StencilOpSeparate(GL_FRONT, GL_INCR, GL_KEEP, GL_KEEP);
+    state.StencilMaskSeparate(GL_FRONT, 0xFF);
+
+    portal.DrawPortalPlane(singleColorShader);
+
+    glm::mat4 destView = view * portal.PairTransform();
+    if (!m_PortalBudget.Recurse(recursionLevel)) {
       // renenable color and depth mask
-      glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
-      glDepthMask(GL_TRUE);
+      state.ColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+      state.DepthMask(GL_TRUE);
+      Scissor(*rect);
       glClear(GL_DEPTH_BUFFER_BIT);
-      glEnable(GL_DEPTH_TEST);
-      glEnable(GL_STENCIL_TEST);
-      glStencilMaskSeparate(GL_FRONT, 0x00);
-      glStencilFuncSeparate(GL_FRONT, GL_EQUAL, recursionLevel + 1, 0xFF);
-
-      DrawLevel(destView, portal.ClippedProj(destView, projection));
+      state.Enable(GL_DEPTH_TEST);
+      state.Enable(GL_STENCIL_TEST);
+      state.StencilMaskSeparate(GL_FRONT, 0x00);
+      state.StencilFuncSeparate(GL_FRONT, GL_EQUAL, recursionLevel + 1, 0xFF);
+
+      glm::mat4 destProjection = portal.ClippedProj(destView, projection);
+      m_CameraBuffer.Push(destView, destProjection,
+                          portal.GetDestination()->Plane());
+      m_PortalBudget.Mark(recursionLevel + 1);
+      DrawLevel(LevelLod(destView, destProjection, recursionLevel + 1));
     } else {
       DrawPortals(destView, portal.ClippedProj(destView, projection),
-                  recursionLevel + 1);
+                  portal.GetDestination()->Plane(), recursionLevel + 1,
+                  *rect);
     }
+    m_CameraBuffer.Bind(viewSlot);
+    Scissor(screenRect);
+    m_PortalBudget.Mark(recursionLevel);
 
-    glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
-    glDepthMask(GL_FALSE);
+    state.ColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+    state.DepthMask(GL_FALSE);
 
-    glEnable(GL_STENCIL_TEST);
-    glStencilMaskSeparate(GL_FRONT, 0xFF);
+    state.Enable(GL_STENCIL_TEST);
+    state.StencilMaskSeparate(GL_FRONT, 0xFF);
 
-    glEnable(GL_DEPTH_TEST);
+    state.Enable(GL_DEPTH_TEST);
 
-    glStencilFuncSeparate(GL_FRONT, GL_NOTEQUAL, recursionLevel + 1, 0xFF);
-    glStencilOpSeparate(GL_FRONT, GL_DECR, GL_KEEP, GL_KEEP);
+    state.StencilFuncSeparate(GL_FRONT, GL_NOTEQUAL, recursionLevel + 1, 0xFF);
+    state.StencilOpSeparate(GL_FRONT, GL_DECR, GL_KEEP, GL_KEEP);
 
-    portal.DrawPortalPlane(view, projection, singleColorShader);
+    portal.DrawPortalPlane(singleColorShader);
   }
 
-  glDisable(GL_STENCIL_TEST);
-  glStencilMaskSeparate(GL_FRONT, 0x00);
+  state.Disable(GL_STENCIL_TEST);
+  state.StencilMaskSeparate(GL_FRONT, 0x00);
 
-  glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
-  glEnable(GL_DEPTH_TEST);
-  glDepthFunc(GL_ALWAYS);
-  glDepthMask(GL_TRUE);
+  state.ColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+  state.Enable(GL_DEPTH_TEST);
+  state.DepthFunc(GL_ALWAYS);
+  state.DepthMask(GL_TRUE);
   glClear(GL_DEPTH_BUFFER_BIT);
 
-  for (const auto& portal : m_Portals) {
-    portal.DrawPortalPlane(view, projection, singleColorShader);
+  if (m_Shaders.IsReady(m_SingleColorInstancedShader)) {
+    pdx::Portal::DrawPortalPlanes(m_Portals,
+                                  m_Shaders.Get(m_SingleColorInstancedShader));
+  } else {
+    for (const auto& portal : m_Portals) {
+      portal.DrawPortalPlane(singleColorShader);
+    }
   }
 
-  glDepthFunc(GL_LESS);
+  state.DepthFunc(GL_LESS);
 
-  glEnable(GL_STENCIL_TEST);
-  glStencilMaskSeparate(GL_FRONT, 0x00);
-  glStencilFuncSeparate(GL_FRONT, GL_LEQUAL, recursionLevel, 0xFF);
-  glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
-  glDepthMask(GL_TRUE);
-  glEnable(GL_DEPTH_TEST);
+  state.Enable(GL_STENCIL_TEST);
+  state.StencilMaskSeparate(GL_FRONT, 0x00);
+  state.StencilFuncSeparate(GL_FRONT, GL_LEQUAL, recursionLevel, 0xFF);
+  state.ColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+  state.DepthMask(GL_TRUE);
+  state.Enable(GL_DEPTH_TEST);
 
-  DrawLevel(view, projection);
+  DrawLevel(LevelLod(view, projection, recursionLevel));
 }
-auto Game::DrawLevel(const glm::mat4& view, const glm::mat4& projection) const
-    -> void {
-  pdx::Shader shader("simple.vert", "simple.frag");
+auto Game::DrawPortalTargets(const glm::mat4& view,
+                             const glm::mat4& projection) -> void {
+  if (m_PortalTargets.Size() != m_Portals.size()) {
+    m_PortalTargets.Create(m_Portals.size(), m_WindowWidth, m_WindowHeight);
+  }
+
+  struct TargetView {
+    glm::mat4 view;
+    glm::mat4 projection;
+    // view projection of the view the portal is seen from
+    glm::mat4 surface;
+    // whose image this is, the first view is the camera's own
+    uint32_t portal;
+    uint32_t level;
+    // portals visible in this view
+    std::vector<uint32_t> sources;
+  };
+  // every portal gets one image, drawn from the shallowest view that sees it
+  const glm::vec4 screen(-1.0f, -1.0f, 1.0f, 1.0f);
+  std::vector<TargetView> views;
+  std::vector<bool> seen(m_Portals.size(), false);
+  views.push_back(TargetView{view, projection, glm::mat4(1.0f), 0, 0, {}});
+  for (size_t i = 0; i < views.size(); ++i) {
+    glm::mat4 viewProj = views[i].projection * views[i].view;
+    // the portal a view looks out of lies on its near plane
+    uint32_t exit = UINT32_MAX;
+    if (i > 0) {
+      exit = (uint32_t)(m_Portals[views[i].portal].GetDestination() -
+                        m_Portals.data());
+    }
+    for (uint32_t p = 0; p < m_Portals.size(); ++p) {
+      const pdx::Portal& portal = m_Portals[p];
+      if (p == exit) {
+        continue;
+      }
+      if (!portal.ScreenRect(viewProj, screen).has_value()) {
+        ++m_CulledPortalViews;
+        continue;
+      }
+      views[i].sources.push_back(p);
+      if (seen[p]) {
+        continue;
+      }
+      seen[p] = true;
+      glm::mat4 destView = views[i].view * portal.PairTransform();
+      views.push_back(TargetView{destView,
+                                 portal.ClippedProj(destView, projection),
+                                 viewProj, p, views[i].level + 1, {}});
+    }
+  }
+  m_PortalViews = (uint32_t)views.size() - 1;
+
+  pdx::GLState& state = pdx::GLState::Get();
+  state.Disable(GL_SCISSOR_TEST);
+  state.Disable(GL_STENCIL_TEST);
+  state.Enable(GL_CULL_FACE);
+  state.CullFace(GL_BACK);
+  state.Enable(GL_DEPTH_TEST);
+  state.DepthFunc(GL_LESS);
+  state.DepthMask(GL_TRUE);
+  state.ColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+
+  // images read this frame are the previous frame's, Present swaps them in
+  bool sceneChanged = m_LevelDraws.Changed();
+  for (size_t i = 1; i < views.size(); ++i) {
+    const TargetView& target = views[i];
+    if (!m_PortalTargets.Begin(target.portal,
+                               target.projection * target.view,
+                               target.surface, target.sources,
+                               sceneChanged)) {
+      continue;
+    }
+    m_PortalViewArea += 1.0f;
+    m_PortalBudget.Mark(target.level);
+    m_CameraBuffer.Push(target.view, target.projection,
+                        m_Portals[target.portal].GetDestination()->Plane());
+    DrawLevel(LevelLod(target.view, target.projection, target.level));
+    DrawPortalViews(target.sources);
+  }
+  m_PortalTargets.Present();
+
+  m_PortalBudget.Mark(0);
+  m_CameraBuffer.Push(view, projection, glm::vec4(0.0f));
+  DrawLevel(LevelLod(view, projection, 0));
+  DrawPortalViews(views[0].sources);
+}
+
+auto Game::DrawPortalViews(std::span<const uint32_t> portals) -> void {
+  const pdx::Shader& singleColorShader = m_Shaders.Get(m_SingleColorShader);
+  const pdx::Shader& portalViewShader = m_Shaders.Get(m_PortalViewShader);
+  pdx::GLState& state = pdx::GLState::Get();
+  for (uint32_t p : portals) {
+    GLuint texture = m_PortalTargets.Texture(p);
+    if (texture == 0) {
+      m_Portals[p].DrawPortalPlane(singleColorShader);
+      continue;
+    }
+    portalViewShader.Use();
+    portalViewShader.SetMat4fv("surfaceViewProj", m_PortalTargets.Surface(p));
+    portalViewShader.Set1i("portalView", pdx::PORTAL_VIEW_UNIT);
+    state.BindTexture(pdx::PORTAL_VIEW_UNIT, GL_TEXTURE_2D, texture);
+    state.BindSampler(pdx::PORTAL_VIEW_UNIT, 0);
+    m_Portals[p].DrawPortalPlane(portalViewShader);
+  }
+}
+
+auto Game::BuildLevel() -> void {
+  m_LevelDraws.Clear();
   for (const auto& portal : m_Portals) {
-    portal.DrawPortalFrame(view, projection, shader);
+    portal.AddPortalFrame(m_LevelDraws);
   }
-  shader.Use();
-  {
+  if (const pdx::Model *floor = m_Assets.Get(m_Floor)) {
     glm::mat4 model =
         glm::scale(glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, -3.0, 0.0f)),
                    glm::vec3(10.0f, 1.0f, 10.0f));
-    shader.SetMat4fv("model", model);
-    shader.SetMat4fv("view", view);
-    shader.SetMat4fv("projection", projection);
-    m_Models[0].Draw();
+    m_LevelDraws.Add(*floor, model);
   }
-  shader.Use();
-  {
+  if (const pdx::Model *cube = m_Assets.Get(m_Cube)) {
     glm::mat4 model =
         glm::scale(glm::translate(glm::mat4(1.0f), glm::vec3(0.2f, 0.0, 0.0f)),
                    glm::vec3(1.0f, 1.0f, 1.0f));
-    shader.SetMat4fv("model", model);
-    shader.SetMat4fv("view", view);
-    shader.SetMat4fv("projection", projection);
-    m_Models[1].Draw();
+    m_LevelDraws.Add(*cube, model);
   }
+  m_LevelDraws.Upload();
+}
+
+auto Game::Scissor(const glm::vec4& rect) -> void {
+  GLint left = (GLint)std::floor((rect.x * 0.5f + 0.5f) * m_WindowWidth);
+  GLint bottom = (GLint)std::floor((rect.y * 0.5f + 0.5f) * m_WindowHeight);
+  GLint right = (GLint)std::ceil((rect.z * 0.5f + 0.5f) * m_WindowWidth);
+  GLint top = (GLint)std::ceil((rect.w * 0.5f + 0.5f) * m_WindowHeight);
+  pdx::GLState& state = pdx::GLState::Get();
+  state.Enable(GL_SCISSOR_TEST);
+  state.Scissor(left, bottom, right - left, top - bottom);
+}
+
+auto Game::LevelLod(const glm::mat4& view, const glm::mat4& projection,
+                    uint32_t recursionLevel) const -> pdx::LodView {
+  return pdx::LodView{view, projection[1][1] * m_WindowHeight * 0.5f,
+                      LOD_MAX_ERROR_PIXELS,
+                      recursionLevel * LOD_BIAS_PER_PORTAL};
+}
+
+auto Game::DrawLevel(const pdx::LodView& lod) -> void {
+  m_LevelDraws.Submit(m_Shaders.Get(m_SimpleMultiDrawShader),
+                      m_Shaders.IsReady(m_SimpleMultiDrawShader),
+                      m_Shaders.Get(m_SimpleShader), lod);
 }
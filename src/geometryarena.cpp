@@ -0,0 +1,338 @@
+#include "geometryarena.hpp"
+#include "glextensions.hpp"
+#include "glstate.hpp"
+
+#include <algorithm>
+#include <glm/glm.hpp>
+#include <iostream>
+
+using namespace pdx;
+
+static auto CreateBuffer(size_t size) -> GLuint {
+  GLuint buffer;
+  glGenBuffers(1, &buffer);
+  // the copy binding point leaves whatever VAO is bound untouched
+  glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+  const GLExtensions& extensions = GLExtensions::Get();
+  if (extensions.BufferStorage != nullptr) {
+    extensions.BufferStorage(GL_COPY_WRITE_BUFFER, size, nullptr,
+                             GL_DYNAMIC_STORAGE_BIT);
+  } else {
+    glBufferData(GL_COPY_WRITE_BUFFER, size, nullptr, GL_STATIC_DRAW);
+  }
+  glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+  return buffer;
+}
+
+static auto UploadRange(GLuint buffer, size_t offset,
+                        std::span<const std::byte> data) -> void {
+  if (data.empty()) {
+    return;
+  }
+  glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+  glBufferSubData(GL_COPY_WRITE_BUFFER, offset, data.size(), data.data());
+  glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+}
+
+static auto VertexStride(VertexFormat format) -> size_t {
+  switch (format) {
+  case VertexFormat::QUANTIZED:
+    return sizeof(QuantizedVertex);
+  case VertexFormat::STANDARD:
+  default:
+    return sizeof(Vertex);
+  }
+}
+
+auto GeometryArena::Get() -> GeometryArena& {
+  static GeometryArena arena;
+  return arena;
+}
+
+auto GeometryArena::Allocate(std::span<const pdx::Vertex> vertices,
+                             std::span<const uint32_t> indices)
+    -> std::shared_ptr<const pdx::GeometryRange> {
+  return Allocate(VertexFormat::STANDARD, std::as_bytes(vertices), indices,
+                  UINT32_MAX);
+}
+
+auto GeometryArena::Allocate(std::span<const pdx::QuantizedVertex> vertices,
+                             std::span<const uint32_t> indices,
+                             const pdx::Dequantization& dequantization)
+    -> std::shared_ptr<const pdx::GeometryRange> {
+  uint32_t mesh = AllocateMesh(dequantization);
+  auto range = Allocate(VertexFormat::QUANTIZED, std::as_bytes(vertices),
+                        indices, mesh);
+  if (range == nullptr) {
+    m_MeshSlots.Free(mesh, 1);
+  }
+  return range;
+}
+
+auto GeometryArena::Allocate(pdx::VertexFormat format,
+                             std::span<const std::byte> vertexData,
+                             std::span<const uint32_t> indices, uint32_t mesh)
+    -> std::shared_ptr<const pdx::GeometryRange> {
+  const size_t stride = VertexStride(format);
+  const size_t vertexCount = vertexData.size() / stride;
+
+  GeometryRange range{format, 0, 0, (uint32_t)vertexCount, 0,
+                      (uint32_t)indices.size(), mesh};
+  bool placed = false;
+  for (uint32_t i = 0; i < m_Pages.size() && !placed; ++i) {
+    Page& page = m_Pages[i];
+    if (page.format != format) {
+      continue;
+    }
+    std::optional<uint64_t> firstVertex =
+        page.vertices.Allocate(vertexCount);
+    if (!firstVertex) {
+      continue;
+    }
+    std::optional<uint64_t> firstIndex = page.indices.Allocate(indices.size());
+    if (!firstIndex) {
+      page.vertices.Free(*firstVertex, vertexCount);
+      continue;
+    }
+    range.page = i;
+    range.firstVertex = (uint32_t)*firstVertex;
+    range.firstIndex = (uint32_t)*firstIndex;
+    placed = true;
+  }
+  if (!placed) {
+    // meshes larger than a page get a page of their own
+    range.page = CreatePage(
+        format, std::max(PAGE_VERTEX_BYTES / stride, vertexCount),
+        std::max(PAGE_INDEX_BYTES / sizeof(uint32_t), indices.size()));
+    if (range.page == UINT32_MAX) {
+      return nullptr;
+    }
+    Page& page = m_Pages[range.page];
+    range.firstVertex = (uint32_t)*page.vertices.Allocate(vertexCount);
+    range.firstIndex = (uint32_t)*page.indices.Allocate(indices.size());
+  }
+
+  const Page& page = m_Pages[range.page];
+  UploadRange(page.vbo, range.firstVertex * stride, vertexData);
+  UploadRange(page.ebo, range.firstIndex * sizeof(uint32_t),
+              std::as_bytes(indices));
+
+  const uint32_t generation = m_Generation;
+  return std::shared_ptr<const GeometryRange>(
+      new GeometryRange(range), [generation](const GeometryRange* range) {
+        GeometryArena& arena = GeometryArena::Get();
+        if (arena.m_Generation == generation) {
+          arena.Free(*range);
+        }
+        delete range;
+      });
+}
+
+auto GeometryArena::Bind(const pdx::GeometryRange& range) -> void {
+  FormatState& state = m_Formats[(size_t)range.format];
+  if (state.vao == 0) {
+    state.vao = CreateVertexArray(range.format);
+  }
+  GLState::Get().BindVertexArray(state.vao);
+  if (state.page != range.page) {
+    // only this class touches the shared VAOs, so the attached page can be
+    // tracked here instead of going through GLState
+    const Page& page = m_Pages[range.page];
+    glBindVertexBuffer(0, page.vbo, 0, VertexStride(range.format));
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, page.ebo);
+    state.page = range.page;
+  }
+  if (range.mesh != UINT32_MAX && range.mesh != m_BoundMesh) {
+    glBindBufferRange(GL_UNIFORM_BUFFER, MESH_BLOCK_BINDING, m_Meshes,
+                      m_MeshStride * range.mesh, sizeof(Dequantization));
+    m_BoundMesh = range.mesh;
+  }
+}
+
+auto GeometryArena::BindInstances(const pdx::GeometryRange& range,
+                                  GLuint buffer, GLintptr offset) -> void {
+  Bind(range);
+  glBindVertexBuffer(2, buffer, offset, sizeof(glm::mat4));
+}
+
+auto GeometryArena::Clear() -> void {
+  GLState& state = GLState::Get();
+  for (FormatState& format : m_Formats) {
+    if (format.vao != 0) {
+      state.DeleteVertexArray(format.vao);
+    }
+    format = FormatState{};
+  }
+  for (const Page& page : m_Pages) {
+    glDeleteBuffers(1, &page.vbo);
+    glDeleteBuffers(1, &page.ebo);
+  }
+  m_Pages.clear();
+  glDeleteBuffers(1, &m_DrawIds);
+  m_DrawIds = 0;
+  glDeleteBuffers(1, &m_Meshes);
+  m_Meshes = 0;
+  m_MeshSlots = RangeAllocator();
+  m_BoundMesh = UINT32_MAX;
+  ++m_Generation;
+}
+
+auto GeometryArena::Pages() const -> size_t { return m_Pages.size(); }
+
+auto GeometryArena::UsedBytes() const -> size_t {
+  size_t bytes = 0;
+  for (const Page& page : m_Pages) {
+    bytes += page.vertices.Used() * VertexStride(page.format) +
+             page.indices.Used() * sizeof(uint32_t);
+  }
+  return bytes;
+}
+
+auto GeometryArena::CapacityBytes() const -> size_t {
+  size_t bytes = 0;
+  for (const Page& page : m_Pages) {
+    bytes += page.vertices.Capacity() * VertexStride(page.format) +
+             page.indices.Capacity() * sizeof(uint32_t);
+  }
+  return bytes;
+}
+
+auto GeometryArena::Bytes(const pdx::GeometryRange& range) -> size_t {
+  return range.vertexCount * VertexStride(range.format) +
+         range.indexCount * sizeof(uint32_t);
+}
+
+auto GeometryArena::AllocateMesh(const pdx::Dequantization& dequantization)
+    -> uint32_t {
+  if (m_Meshes == 0) {
+    GLint alignment = 256;
+    glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+    m_MeshStride =
+        (sizeof(Dequantization) + alignment - 1) / alignment * alignment;
+  }
+  std::optional<uint64_t> slot = m_MeshSlots.Allocate(1);
+  if (!slot) {
+    // slots in use stay where they are, so carry them over like the
+    // CameraBuffer does
+    uint64_t capacity = m_MeshSlots.Capacity();
+    uint64_t grown = std::max<uint64_t>(capacity * 2, 64);
+    GLuint buffer = CreateBuffer(grown * m_MeshStride);
+    if (m_Meshes != 0) {
+      glBindBuffer(GL_COPY_READ_BUFFER, m_Meshes);
+      glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+      glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0,
+                          capacity * m_MeshStride);
+      glBindBuffer(GL_COPY_READ_BUFFER, 0);
+      glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+      glDeleteBuffers(1, &m_Meshes);
+    }
+    m_Meshes = buffer;
+    m_MeshSlots.Grow(grown);
+    m_BoundMesh = UINT32_MAX;
+    slot = m_MeshSlots.Allocate(1);
+  }
+  UploadRange(m_Meshes, *slot * m_MeshStride,
+              std::as_bytes(std::span(&dequantization, 1)));
+  return static_cast<uint32_t>(*slot);
+}
+
+auto GeometryArena::CreatePage(pdx::VertexFormat format, size_t vertexCount,
+                               size_t indexCount) -> uint32_t {
+  Page page{format, CreateBuffer(vertexCount * VertexStride(format)),
+            CreateBuffer(indexCount * sizeof(uint32_t)),
+            RangeAllocator(vertexCount), RangeAllocator(indexCount)};
+  if (page.vbo == 0 || page.ebo == 0) {
+    std::cout << "Failed to create geometry page of " << vertexCount
+              << " vertices and " << indexCount << " indices" << std::endl;
+    glDeleteBuffers(1, &page.vbo);
+    glDeleteBuffers(1, &page.ebo);
+    return UINT32_MAX;
+  }
+  m_Pages.push_back(std::move(page));
+  return static_cast<uint32_t>(m_Pages.size() - 1);
+}
+
+auto GeometryArena::CreateVertexArray(pdx::VertexFormat format) -> pdx::vao_t {
+  vao_t vao;
+  glGenVertexArrays(1, &vao);
+  GLState::Get().BindVertexArray(vao);
+  // separate attribute formats let every page share this VAO, switching
+  // pages only rebinds binding point 0 and the element buffer
+  switch (format) {
+  case VertexFormat::STANDARD:
+  default:
+    glEnableVertexAttribArray(0);
+    glVertexAttribFormat(0, 3, GL_FLOAT, GL_FALSE, offsetof(Vertex, position));
+    glEnableVertexAttribArray(1);
+    glVertexAttribFormat(1, 3, GL_FLOAT, GL_FALSE, offsetof(Vertex, normal));
+    glEnableVertexAttribArray(2);
+    glVertexAttribFormat(2, 4, GL_FLOAT, GL_FALSE, offsetof(Vertex, tangent));
+    glEnableVertexAttribArray(3);
+    glVertexAttribFormat(3, 2, GL_FLOAT, GL_FALSE,
+                         offsetof(Vertex, texcoord0));
+    glEnableVertexAttribArray(4);
+    glVertexAttribFormat(4, 2, GL_FLOAT, GL_FALSE,
+                         offsetof(Vertex, texcoord1));
+    break;
+  case VertexFormat::QUANTIZED:
+    // the normalized integers are turned into floats by the vertex fetch,
+    // the Mesh block scales them back into place
+    glEnableVertexAttribArray(0);
+    glVertexAttribFormat(0, 4, GL_SHORT, GL_TRUE,
+                         offsetof(QuantizedVertex, position));
+    glEnableVertexAttribArray(1);
+    glVertexAttribFormat(1, 2, GL_SHORT, GL_TRUE,
+                         offsetof(QuantizedVertex, normal));
+    glEnableVertexAttribArray(2);
+    glVertexAttribFormat(2, 2, GL_SHORT, GL_TRUE,
+                         offsetof(QuantizedVertex, tangent));
+    glEnableVertexAttribArray(3);
+    glVertexAttribFormat(3, 2, GL_UNSIGNED_SHORT, GL_TRUE,
+                         offsetof(QuantizedVertex, texcoord0));
+    glEnableVertexAttribArray(4);
+    glVertexAttribFormat(4, 2, GL_UNSIGNED_SHORT, GL_TRUE,
+                         offsetof(QuantizedVertex, texcoord1));
+    break;
+  }
+  for (GLuint attrib = 0; attrib < 5; ++attrib) {
+    glVertexAttribBinding(attrib, 0);
+  }
+
+  if (m_DrawIds == 0) {
+    std::vector<uint32_t> ids(MAX_DRAW_IDS);
+    for (uint32_t i = 0; i < MAX_DRAW_IDS; ++i) {
+      ids[i] = i;
+    }
+    m_DrawIds = CreateBuffer(ids.size() * sizeof(uint32_t));
+    UploadRange(m_DrawIds, 0, std::as_bytes(std::span(ids)));
+  }
+  glEnableVertexAttribArray(DRAW_ID_ATTRIB);
+  glVertexAttribIFormat(DRAW_ID_ATTRIB, 1, GL_UNSIGNED_INT, 0);
+  glVertexAttribBinding(DRAW_ID_ATTRIB, 1);
+  glVertexBindingDivisor(1, 1);
+  glBindVertexBuffer(1, m_DrawIds, 0, sizeof(uint32_t));
+
+  for (GLuint column = 0; column < 4; ++column) {
+    glEnableVertexAttribArray(INSTANCE_ATTRIB + column);
+    glVertexAttribFormat(INSTANCE_ATTRIB + column, 4, GL_FLOAT, GL_FALSE,
+                         column * sizeof(glm::vec4));
+    glVertexAttribBinding(INSTANCE_ATTRIB + column, 2);
+  }
+  glVertexBindingDivisor(2, 1);
+  // enabled arrays need a buffer even for draws that do not read them, the
+  // id buffer is large enough for the single instance a plain draw fetches
+  glBindVertexBuffer(2, m_DrawIds, 0, sizeof(glm::mat4));
+  return vao;
+}
+
+auto GeometryArena::Free(const pdx::GeometryRange& range) -> void {
+  if (range.page >= m_Pages.size()) {
+    return;
+  }
+  Page& page = m_Pages[range.page];
+  page.vertices.Free(range.firstVertex, range.vertexCount);
+  page.indices.Free(range.firstIndex, range.indexCount);
+  if (range.mesh != UINT32_MAX) {
+    m_MeshSlots.Free(range.mesh, 1);
+  }
+}
@@ -0,0 +1,70 @@
+#include "glextensions.hpp"
+
+#include <SDL2/SDL.h>
+
+#include <iostream>
+
+using namespace pdx;
+
+static GLExtensions extensions;
+
+template <typename T> static auto LoadProc(const char *name) -> T {
+  return reinterpret_cast<T>(SDL_GL_GetProcAddress(name));
+}
+
+auto GLExtensions::Load() -> void {
+  extensions = GLExtensions{};
+
+  if (SDL_GL_ExtensionSupported("GL_KHR_parallel_shader_compile")) {
+    extensions.MaxShaderCompilerThreads =
+        LoadProc<PFNGLMAXSHADERCOMPILERTHREADSKHRPROC>(
+            "glMaxShaderCompilerThreadsKHR");
+  } else if (SDL_GL_ExtensionSupported("GL_ARB_parallel_shader_compile")) {
+    extensions.MaxShaderCompilerThreads =
+        LoadProc<PFNGLMAXSHADERCOMPILERTHREADSKHRPROC>(
+            "glMaxShaderCompilerThreadsARB");
+  }
+  extensions.parallelShaderCompile =
+      extensions.MaxShaderCompilerThreads != nullptr;
+
+  GLint major = 0, minor = 0;
+  glGetIntegerv(GL_MAJOR_VERSION, &major);
+  glGetIntegerv(GL_MINOR_VERSION, &minor);
+  if (major * 10 + minor >= 44 ||
+      SDL_GL_ExtensionSupported("GL_ARB_buffer_storage")) {
+    extensions.BufferStorage =
+        LoadProc<PFNGLBUFFERSTORAGEPROC>("glBufferStorage");
+  }
+
+  if (major * 10 + minor >= 46 ||
+      SDL_GL_ExtensionSupported("GL_ARB_texture_filter_anisotropic") ||
+      SDL_GL_ExtensionSupported("GL_EXT_texture_filter_anisotropic")) {
+    glGetFloatv(GL_MAX_TEXTURE_MAX_ANISOTROPY, &extensions.maxAnisotropy);
+  }
+  extensions.textureCompressionS3tc =
+      SDL_GL_ExtensionSupported("GL_EXT_texture_compression_s3tc");
+  extensions.textureCompressionS3tcSrgb =
+      extensions.textureCompressionS3tc &&
+      (SDL_GL_ExtensionSupported("GL_EXT_texture_sRGB") ||
+       SDL_GL_ExtensionSupported("GL_EXT_texture_compression_s3tc_srgb"));
+  extensions.multiDrawIndirect =
+      glMultiDrawElementsIndirect != nullptr &&
+      (major * 10 + minor >= 43 ||
+       (SDL_GL_ExtensionSupported("GL_ARB_multi_draw_indirect") &&
+        SDL_GL_ExtensionSupported("GL_ARB_shader_storage_buffer_object")));
+
+  std::cout << "Parallel shader compile: "
+            << (extensions.parallelShaderCompile ? "yes" : "no") << std::endl;
+  std::cout << "Buffer storage: "
+            << (extensions.BufferStorage != nullptr ? "yes" : "no")
+            << std::endl;
+  std::cout << "Max anisotropy: " << extensions.maxAnisotropy
+            << ", S3TC: " << (extensions.textureCompressionS3tc ? "yes" : "no")
+            << ", sRGB S3TC: "
+            << (extensions.textureCompressionS3tcSrgb ? "yes" : "no")
+            << std::endl;
+  std::cout << "Multi draw indirect: "
+            << (extensions.multiDrawIndirect ? "yes" : "no") << std::endl;
+}
+
+auto GLExtensions::Get() -> const GLExtensions& { return extensions; }
@@ -0,0 +1,278 @@
+#include "glstate.hpp"
+
+using namespace pdx;
+
+static auto CapIndex(GLenum cap) -> int {
+  switch (cap) {
+  case GL_BLEND:
+    return 0;
+  case GL_CULL_FACE:
+    return 1;
+  case GL_DEPTH_TEST:
+    return 2;
+  case GL_SCISSOR_TEST:
+    return 3;
+  case GL_STENCIL_TEST:
+    return 4;
+  default:
+    return -1;
+  }
+}
+
+auto GLState::Get() -> GLState& {
+  static GLState state;
+  return state;
+}
+
+GLState::GLState() { Invalidate(); }
+
+auto GLState::Count(bool changed) -> bool {
+  if (changed) {
+    ++m_Issued;
+  } else {
+    ++m_Filtered;
+  }
+  return changed;
+}
+
+template <typename T> auto GLState::Update(T& shadow, const T& value) -> bool {
+  if (!Count(shadow != value)) {
+    return false;
+  }
+  shadow = value;
+  return true;
+}
+
+auto GLState::SetCap(GLenum cap, bool enabled) -> void {
+  int index = CapIndex(cap);
+  if (index < 0) {
+    Count(true);
+  } else if (!Update(m_Caps[index], (uint32_t)enabled)) {
+    return;
+  }
+  if (enabled) {
+    glEnable(cap);
+  } else {
+    glDisable(cap);
+  }
+}
+
+auto GLState::Enable(GLenum cap) -> void { SetCap(cap, true); }
+
+auto GLState::Disable(GLenum cap) -> void { SetCap(cap, false); }
+
+auto GLState::UseProgram(pdx::program_t program) -> void {
+  if (Update(m_Program, program)) {
+    glUseProgram(program);
+  }
+}
+
+auto GLState::BindVertexArray(pdx::vao_t vao) -> void {
+  if (Update(m_Vao, vao)) {
+    glBindVertexArray(vao);
+  }
+}
+
+auto GLState::ActiveTexture(uint32_t unit) -> void {
+  if (Update(m_ActiveTexture, unit)) {
+    glActiveTexture(GL_TEXTURE0 + unit);
+  }
+}
+
+auto GLState::BindTexture(uint32_t unit, GLenum target, GLuint texture)
+    -> void {
+  // only 2D textures are shadowed, anything else always goes through
+  if (target != GL_TEXTURE_2D || unit >= MAX_TEXTURE_UNITS) {
+    ActiveTexture(unit);
+    Count(true);
+    glBindTexture(target, texture);
+    return;
+  }
+  if (!Count(m_Textures[unit] != texture)) {
+    return;
+  }
+  ActiveTexture(unit);
+  m_Textures[unit] = texture;
+  glBindTexture(target, texture);
+}
+
+auto GLState::BindSampler(uint32_t unit, GLuint sampler) -> void {
+  // sampler bindings take the unit directly, no ActiveTexture needed
+  if (unit >= MAX_TEXTURE_UNITS) {
+    Count(true);
+    glBindSampler(unit, sampler);
+    return;
+  }
+  if (Update(m_Samplers[unit], sampler)) {
+    glBindSampler(unit, sampler);
+  }
+}
+
+auto GLState::DeleteProgram(pdx::program_t program) -> void {
+  if (m_Program == program) {
+    m_Program = UNKNOWN;
+  }
+  glDeleteProgram(program);
+}
+
+auto GLState::DeleteVertexArray(pdx::vao_t vao) -> void {
+  if (m_Vao == vao) {
+    m_Vao = UNKNOWN;
+  }
+  glDeleteVertexArrays(1, &vao);
+}
+
+auto GLState::DeleteTexture(GLuint texture) -> void {
+  for (auto& bound : m_Textures) {
+    if (bound == texture) {
+      bound = UNKNOWN;
+    }
+  }
+  glDeleteTextures(1, &texture);
+}
+
+auto GLState::DeleteSampler(GLuint sampler) -> void {
+  for (auto& bound : m_Samplers) {
+    if (bound == sampler) {
+      bound = UNKNOWN;
+    }
+  }
+  glDeleteSamplers(1, &sampler);
+}
+
+auto GLState::ColorMask(GLboolean red, GLboolean green, GLboolean blue,
+                        GLboolean alpha) -> void {
+  uint32_t mask = (red ? 1 : 0) | (green ? 2 : 0) | (blue ? 4 : 0) |
+                  (alpha ? 8 : 0);
+  if (Update(m_ColorMask, mask)) {
+    glColorMask(red, green, blue, alpha);
+  }
+}
+
+auto GLState::DepthMask(GLboolean flag) -> void {
+  if (Update(m_DepthMask, (uint32_t)flag)) {
+    glDepthMask(flag);
+  }
+}
+
+auto GLState::DepthFunc(GLenum func) -> void {
+  if (Update(m_DepthFunc, func)) {
+    glDepthFunc(func);
+  }
+}
+
+auto GLState::CullFace(GLenum mode) -> void {
+  if (Update(m_CullFace, mode)) {
+    glCullFace(mode);
+  }
+}
+
+auto GLState::BlendFunc(GLenum sfactor, GLenum dfactor) -> void {
+  if (Update(m_BlendFunc, std::array<GLenum, 2>{sfactor, dfactor})) {
+    glBlendFunc(sfactor, dfactor);
+  }
+}
+
+auto GLState::Scissor(GLint x, GLint y, GLsizei width, GLsizei height)
+    -> void {
+  if (Update(m_Scissor, std::array<GLint, 4>{x, y, width, height})) {
+    glScissor(x, y, width, height);
+  }
+}
+
+auto GLState::StencilFuncSeparate(GLenum face, GLenum func, GLint ref,
+                                  GLuint mask) -> void {
+  bool changed = false;
+  if (face != GL_BACK) {
+    StencilFace& front = m_StencilFront;
+    changed |= front.func != func || front.ref != ref || front.funcMask != mask;
+    front.func = func;
+    front.ref = ref;
+    front.funcMask = mask;
+  }
+  if (face != GL_FRONT) {
+    StencilFace& back = m_StencilBack;
+    changed |= back.func != func || back.ref != ref || back.funcMask != mask;
+    back.func = func;
+    back.ref = ref;
+    back.funcMask = mask;
+  }
+  if (!Count(changed)) {
+    return;
+  }
+  glStencilFuncSeparate(face, func, ref, mask);
+}
+
+auto GLState::StencilOpSeparate(GLenum face, GLenum sfail, GLenum dpfail,
+                                GLenum dppass) -> void {
+  bool changed = false;
+  if (face != GL_BACK) {
+    StencilFace& front = m_StencilFront;
+    changed |= front.sfail != sfail || front.dpfail != dpfail ||
+               front.dppass != dppass;
+    front.sfail = sfail;
+    front.dpfail = dpfail;
+    front.dppass = dppass;
+  }
+  if (face != GL_FRONT) {
+    StencilFace& back = m_StencilBack;
+    changed |=
+        back.sfail != sfail || back.dpfail != dpfail || back.dppass != dppass;
+    back.sfail = sfail;
+    back.dpfail = dpfail;
+    back.dppass = dppass;
+  }
+  if (!Count(changed)) {
+    return;
+  }
+  glStencilOpSeparate(face, sfail, dpfail, dppass);
+}
+
+auto GLState::StencilMaskSeparate(GLenum face, GLuint mask) -> void {
+  bool changed = false;
+  if (face != GL_BACK) {
+    changed |= m_StencilFront.writeMask != mask;
+    m_StencilFront.writeMask = mask;
+  }
+  if (face != GL_FRONT) {
+    changed |= m_StencilBack.writeMask != mask;
+    m_StencilBack.writeMask = mask;
+  }
+  if (!Count(changed)) {
+    return;
+  }
+  glStencilMaskSeparate(face, mask);
+}
+
+auto GLState::Invalidate() -> void {
+  m_Caps.fill(UNKNOWN);
+  m_Program = UNKNOWN;
+  m_Vao = UNKNOWN;
+  m_ActiveTexture = UNKNOWN;
+  m_Textures.fill(UNKNOWN);
+  m_Samplers.fill(UNKNOWN);
+  m_ColorMask = UNKNOWN;
+  m_DepthMask = UNKNOWN;
+  m_DepthFunc = UNKNOWN;
+  m_CullFace = UNKNOWN;
+  m_BlendFunc.fill(UNKNOWN);
+  // no real box has a negative size
+  m_Scissor.fill(-1);
+  // ref and funcMask are always set together with func, so an unknown func
+  // is enough to force the first call through
+  StencilFace unknown{UNKNOWN, 0, 0, UNKNOWN, UNKNOWN, UNKNOWN, -1};
+  m_StencilFront = unknown;
+  m_StencilBack = unknown;
+}
+
+auto GLState::BeginFrame() -> void {
+  m_LastIssued = m_Issued;
+  m_LastFiltered = m_Filtered;
+  m_Issued = 0;
+  m_Filtered = 0;
+  Invalidate();
+}
+
+auto GLState::LastIssued() const -> uint32_t { return m_LastIssued; }
+
+auto GLState::LastFiltered() const -> uint32_t { return m_LastFiltered; }
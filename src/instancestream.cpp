@@ -0,0 +1,47 @@
+#include "instancestream.hpp"
+
+#include <algorithm>
+
+using namespace pdx;
+
+auto InstanceStream::Get() -> InstanceStream& {
+  static InstanceStream stream;
+  return stream;
+}
+
+auto InstanceStream::Push(std::span<const glm::mat4> transforms) -> GLintptr {
+  const size_t size = transforms.size_bytes();
+  if (m_Buffer == 0) {
+    glGenBuffers(1, &m_Buffer);
+  }
+  // the copy binding point leaves whatever VAO is bound untouched
+  glBindBuffer(GL_COPY_WRITE_BUFFER, m_Buffer);
+  if (m_Head + size > m_Capacity) {
+    m_Capacity = std::max(CAPACITY, size);
+    glBufferData(GL_COPY_WRITE_BUFFER, m_Capacity, nullptr, GL_STREAM_DRAW);
+    m_Head = 0;
+  }
+  GLintptr offset = m_Head;
+  glBufferSubData(GL_COPY_WRITE_BUFFER, offset, size, transforms.data());
+  glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+  m_Head += size;
+  m_Instances += static_cast<uint32_t>(transforms.size());
+  return offset;
+}
+
+auto InstanceStream::Buffer() const -> GLuint { return m_Buffer; }
+
+auto InstanceStream::BeginFrame() -> void { m_Instances = 0; }
+
+auto InstanceStream::InstancesThisFrame() const -> uint32_t {
+  return m_Instances;
+}
+
+auto InstanceStream::Clear() -> void {
+  if (m_Buffer != 0) {
+    glDeleteBuffers(1, &m_Buffer);
+  }
+  m_Buffer = 0;
+  m_Capacity = 0;
+  m_Head = 0;
+}
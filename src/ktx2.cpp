@@ -0,0 +1,250 @@
+#include "ktx2.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <numeric>
+#include <vector>
+
+using namespace pdx;
+
+static const uint8_t IDENTIFIER[12] = {0xAB, 'K',  'T',  'X', ' ',  '2',
+                                       '0',  0xBB, '\r', '\n', 0x1A, '\n'};
+
+struct Header {
+  uint8_t identifier[12];
+  uint32_t vkFormat;
+  uint32_t typeSize;
+  uint32_t pixelWidth;
+  uint32_t pixelHeight;
+  uint32_t pixelDepth;
+  uint32_t layerCount;
+  uint32_t faceCount;
+  uint32_t levelCount;
+  uint32_t supercompressionScheme;
+  uint32_t dfdByteOffset;
+  uint32_t dfdByteLength;
+  uint32_t kvdByteOffset;
+  uint32_t kvdByteLength;
+  uint64_t sgdByteOffset;
+  uint64_t sgdByteLength;
+};
+
+struct LevelIndex {
+  uint64_t byteOffset;
+  uint64_t byteLength;
+  uint64_t uncompressedByteLength;
+};
+
+static_assert(sizeof(Header) == 80, "KTX2 header must be packed");
+static_assert(sizeof(LevelIndex) == 24);
+
+auto Ktx2::IsBlockCompressed(uint32_t vkFormat) -> bool {
+  return vkFormat >= BC1_RGBA_UNORM && vkFormat <= BC5_UNORM;
+}
+
+auto Ktx2::FormatBytes(uint32_t vkFormat) -> uint32_t {
+  switch (vkFormat) {
+  case R8_UNORM:
+    return 1;
+  case R8G8_UNORM:
+    return 2;
+  case R8G8B8A8_UNORM:
+  case R8G8B8A8_SRGB:
+    return 4;
+  case BC1_RGBA_UNORM:
+  case BC1_RGBA_SRGB:
+  case BC4_UNORM:
+    return 8;
+  case BC3_UNORM:
+  case BC3_SRGB:
+  case BC5_UNORM:
+    return 16;
+  default:
+    return 0;
+  }
+}
+
+auto Ktx2::LevelSize(uint32_t vkFormat, int32_t width, int32_t height)
+    -> size_t {
+  if (IsBlockCompressed(vkFormat)) {
+    return (size_t)((width + 3) / 4) * ((height + 3) / 4) *
+           FormatBytes(vkFormat);
+  }
+  return (size_t)width * height * FormatBytes(vkFormat);
+}
+
+auto Ktx2::MipLevels(int32_t width, int32_t height) -> int32_t {
+  int32_t levels = 1;
+  while ((width | height) >> levels) {
+    ++levels;
+  }
+  return levels;
+}
+
+auto Ktx2::Read(const uint8_t *data, size_t size, pdx::MeshTexture& texture)
+    -> bool {
+  Header header;
+  if (size < sizeof(header)) {
+    return false;
+  }
+  memcpy(&header, data, sizeof(header));
+  if (memcmp(header.identifier, IDENTIFIER, sizeof(IDENTIFIER)) != 0) {
+    return false;
+  }
+  if (FormatBytes(header.vkFormat) == 0 || header.pixelDepth > 1 ||
+      header.layerCount > 1 || header.faceCount != 1 ||
+      header.supercompressionScheme != 0 || header.pixelWidth == 0 ||
+      header.pixelHeight == 0 || header.pixelWidth > INT32_MAX ||
+      header.pixelHeight > INT32_MAX) {
+    std::cout << "Unsupported KTX2 image (format " << header.vkFormat << ")"
+              << std::endl;
+    return false;
+  }
+
+  // more levels than a full chain would shift the size past its width
+  uint32_t levels = std::max(header.levelCount, 1u);
+  if (levels > (uint32_t)MipLevels((int32_t)header.pixelWidth,
+                                   (int32_t)header.pixelHeight)) {
+    std::cout << "Corrupt KTX2 level count " << levels << std::endl;
+    return false;
+  }
+  size_t indexOffset = sizeof(header);
+  if (indexOffset + levels * sizeof(LevelIndex) > size) {
+    return false;
+  }
+
+  texture.vkFormat = header.vkFormat;
+  texture.width = header.pixelWidth;
+  texture.height = header.pixelHeight;
+  texture.components = 0;
+  texture.bits = 8;
+  texture.mips.clear();
+  texture.pixels.clear();
+  for (uint32_t i = 0; i < levels; ++i) {
+    LevelIndex level;
+    memcpy(&level, data + indexOffset + i * sizeof(level), sizeof(level));
+    int32_t width = std::max(texture.width >> i, 1);
+    int32_t height = std::max(texture.height >> i, 1);
+    if (level.byteOffset > size || level.byteLength > size - level.byteOffset ||
+        level.byteLength != LevelSize(header.vkFormat, width, height)) {
+      std::cout << "Corrupt KTX2 level " << i << std::endl;
+      return false;
+    }
+    texture.mips.push_back(
+        MeshMip{width, height, texture.pixels.size(), level.byteLength});
+    texture.pixels.insert(texture.pixels.end(), data + level.byteOffset,
+                          data + level.byteOffset + level.byteLength);
+  }
+  return true;
+}
+
+// Basic data format descriptor, KTX2 requires one even though the format is
+// fully described by vkFormat
+static auto DataFormatDescriptor(uint32_t vkFormat)
+    -> std::vector<uint32_t> {
+  struct Sample {
+    uint32_t offset;
+    uint32_t bits;
+    uint32_t channel;
+  };
+  std::vector<Sample> samples;
+  uint32_t model = 1; // RGBSDA
+  uint32_t block = 0;
+  bool srgb = vkFormat == Ktx2::R8G8B8A8_SRGB ||
+              vkFormat == Ktx2::BC1_RGBA_SRGB || vkFormat == Ktx2::BC3_SRGB;
+  switch (vkFormat) {
+  case Ktx2::BC1_RGBA_UNORM:
+  case Ktx2::BC1_RGBA_SRGB:
+    model = 128;
+    samples = {{0, 64, 0}};
+    break;
+  case Ktx2::BC3_UNORM:
+  case Ktx2::BC3_SRGB:
+    model = 130;
+    samples = {{0, 64, 15}, {64, 64, 0}};
+    break;
+  case Ktx2::BC4_UNORM:
+    model = 131;
+    samples = {{0, 64, 0}};
+    break;
+  case Ktx2::BC5_UNORM:
+    model = 132;
+    samples = {{0, 64, 0}, {64, 64, 1}};
+    break;
+  default:
+    for (uint32_t i = 0; i < Ktx2::FormatBytes(vkFormat); ++i) {
+      samples.push_back({i * 8, 8, i == 3 ? 15u : i});
+    }
+    break;
+  }
+  if (Ktx2::IsBlockCompressed(vkFormat)) {
+    block = 3 | (3 << 8);
+  }
+
+  uint32_t blockSize = 24 + 16 * (uint32_t)samples.size();
+  std::vector<uint32_t> words = {
+      4 + blockSize,
+      0,
+      2 | (blockSize << 16),
+      model | (1 << 8) | ((srgb ? 2u : 1u) << 16),
+      block,
+      Ktx2::FormatBytes(vkFormat),
+      0};
+  for (const auto& sample : samples) {
+    // alpha stays linear in sRGB images
+    uint32_t linear = (srgb && sample.channel == 15) ? 1u << 31 : 0;
+    words.push_back(sample.offset | ((sample.bits - 1) << 16) |
+                    (sample.channel << 24) | linear);
+    words.push_back(0);
+    words.push_back(0);
+    words.push_back(sample.bits == 8 ? 0xFF : 0xFFFFFFFF);
+  }
+  return words;
+}
+
+auto Ktx2::Write(const std::filesystem::path& path,
+                 const pdx::MeshTexture& texture) -> bool {
+  std::vector<uint32_t> dfd = DataFormatDescriptor(texture.vkFormat);
+  uint32_t levels = (uint32_t)texture.mips.size();
+
+  Header header{};
+  memcpy(header.identifier, IDENTIFIER, sizeof(IDENTIFIER));
+  header.vkFormat = texture.vkFormat;
+  header.typeSize = 1;
+  header.pixelWidth = texture.width;
+  header.pixelHeight = texture.height;
+  header.faceCount = 1;
+  header.levelCount = levels;
+  header.dfdByteOffset =
+      (uint32_t)(sizeof(header) + levels * sizeof(LevelIndex));
+  header.dfdByteLength = (uint32_t)(dfd.size() * sizeof(uint32_t));
+
+  // levels are stored smallest first, each aligned to lcm(block size, 4)
+  size_t alignment = std::lcm<size_t>(FormatBytes(texture.vkFormat), 4);
+  size_t offset = header.dfdByteOffset + header.dfdByteLength;
+  std::vector<LevelIndex> index(levels);
+  for (uint32_t i = levels; i-- > 0;) {
+    offset = (offset + alignment - 1) / alignment * alignment;
+    index[i] = LevelIndex{offset, texture.mips[i].size, texture.mips[i].size};
+    offset += texture.mips[i].size;
+  }
+
+  std::ofstream file(path, std::ios::binary | std::ios::trunc);
+  if (!file) {
+    return false;
+  }
+  file.write((const char *)&header, sizeof(header));
+  file.write((const char *)index.data(), index.size() * sizeof(LevelIndex));
+  file.write((const char *)dfd.data(), header.dfdByteLength);
+  size_t written = header.dfdByteOffset + header.dfdByteLength;
+  static const char padding[16] = {};
+  for (uint32_t i = levels; i-- > 0;) {
+    file.write(padding, index[i].byteOffset - written);
+    file.write((const char *)texture.pixels.data() + texture.mips[i].offset,
+               texture.mips[i].size);
+    written = index[i].byteOffset + index[i].byteLength;
+  }
+  return (bool)file;
+}
@@ -0,0 +1,132 @@
+#include "mappedfile.hpp"
+
+#include <utility>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace pdx;
+
+MappedFile::MappedFile(MappedFile&& other) noexcept
+    : m_Data(std::exchange(other.m_Data, nullptr)),
+      m_Size(std::exchange(other.m_Size, 0))
+#ifdef _WIN32
+      ,
+      m_File(std::exchange(other.m_File, nullptr)),
+      m_Mapping(std::exchange(other.m_Mapping, nullptr))
+#endif
+{
+}
+
+MappedFile::~MappedFile() { Close(); }
+
+auto MappedFile::operator=(MappedFile&& other) noexcept -> MappedFile& {
+  if (this != &other) {
+    Close();
+    m_Data = std::exchange(other.m_Data, nullptr);
+    m_Size = std::exchange(other.m_Size, 0);
+#ifdef _WIN32
+    m_File = std::exchange(other.m_File, nullptr);
+    m_Mapping = std::exchange(other.m_Mapping, nullptr);
+#endif
+  }
+  return *this;
+}
+
+#ifdef _WIN32
+auto MappedFile::Open(const std::filesystem::path& path)
+    -> std::optional<MappedFile> {
+  MappedFile file;
+  file.m_File = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ,
+                            nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL,
+                            nullptr);
+  if (file.m_File == INVALID_HANDLE_VALUE) {
+    file.m_File = nullptr;
+    return {};
+  }
+  LARGE_INTEGER size;
+  if (!GetFileSizeEx(file.m_File, &size)) {
+    return {};
+  }
+  file.m_Size = static_cast<size_t>(size.QuadPart);
+  // empty files cannot be mapped but are still valid
+  if (file.m_Size == 0) {
+    return std::make_optional(std::move(file));
+  }
+  file.m_Mapping =
+      CreateFileMappingW(file.m_File, nullptr, PAGE_READONLY, 0, 0, nullptr);
+  if (file.m_Mapping == nullptr) {
+    return {};
+  }
+  file.m_Data = static_cast<const uint8_t *>(
+      MapViewOfFile(file.m_Mapping, FILE_MAP_READ, 0, 0, 0));
+  if (file.m_Data == nullptr) {
+    return {};
+  }
+  return std::make_optional(std::move(file));
+}
+
+auto MappedFile::Close() -> void {
+  if (m_Data != nullptr) {
+    UnmapViewOfFile(m_Data);
+  }
+  if (m_Mapping != nullptr) {
+    CloseHandle(m_Mapping);
+  }
+  if (m_File != nullptr) {
+    CloseHandle(m_File);
+  }
+  m_Data = nullptr;
+  m_Mapping = nullptr;
+  m_File = nullptr;
+  m_Size = 0;
+}
+#else
+auto MappedFile::Open(const std::filesystem::path& path)
+    -> std::optional<MappedFile> {
+  int fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    return {};
+  }
+  struct stat st;
+  if (fstat(fd, &st) != 0) {
+    close(fd);
+    return {};
+  }
+
+  MappedFile file;
+  file.m_Size = static_cast<size_t>(st.st_size);
+  // empty files cannot be mapped but are still valid
+  if (file.m_Size > 0) {
+    void *data = mmap(nullptr, file.m_Size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (data == MAP_FAILED) {
+      close(fd);
+      return {};
+    }
+    file.m_Data = static_cast<const uint8_t *>(data);
+  }
+  // the mapping keeps the file alive on its own
+  close(fd);
+  return std::make_optional(std::move(file));
+}
+
+auto MappedFile::Close() -> void {
+  if (m_Data != nullptr) {
+    munmap(const_cast<uint8_t *>(m_Data), m_Size);
+  }
+  m_Data = nullptr;
+  m_Size = 0;
+}
+#endif
+
+auto MappedFile::Data() const -> const uint8_t * { return m_Data; }
+
+auto MappedFile::Size() const -> size_t { return m_Size; }
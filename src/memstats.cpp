@@ -0,0 +1,58 @@
+#include "memstats.hpp"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+// windows.h has to come first
+#include <psapi.h>
+#else
+#include <fstream>
+#include <sys/resource.h>
+#include <unistd.h>
+#endif
+
+#ifdef _WIN32
+auto pdx::PeakResidentBytes() -> size_t {
+  PROCESS_MEMORY_COUNTERS counters;
+  if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters,
+                            sizeof(counters))) {
+    return 0;
+  }
+  return counters.PeakWorkingSetSize;
+}
+
+auto pdx::CurrentResidentBytes() -> size_t {
+  PROCESS_MEMORY_COUNTERS counters;
+  if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters,
+                            sizeof(counters))) {
+    return 0;
+  }
+  return counters.WorkingSetSize;
+}
+#else
+auto pdx::PeakResidentBytes() -> size_t {
+  struct rusage usage;
+  if (getrusage(RUSAGE_SELF, &usage) != 0) {
+    return 0;
+  }
+#ifdef __APPLE__
+  return static_cast<size_t>(usage.ru_maxrss);
+#else
+  // linux reports kilobytes
+  return static_cast<size_t>(usage.ru_maxrss) * 1024;
+#endif
+}
+
+auto pdx::CurrentResidentBytes() -> size_t {
+#ifdef __linux__
+  std::ifstream statm("/proc/self/statm");
+  size_t pages = 0;
+  size_t resident = 0;
+  if (statm >> pages >> resident) {
+    return resident * static_cast<size_t>(sysconf(_SC_PAGESIZE));
+  }
+#endif
+  return 0;
+}
+#endif
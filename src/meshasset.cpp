@@ -0,0 +1,225 @@
+#include "ktx2.hpp"
+#include "meshasset.hpp"
+#include "meshoptimize.hpp"
+#include "mappedfile.hpp"
+#include "memstats.hpp"
+
+#include <SDL2/SDL.h>
+
+#include <filesystem>
+#include <iostream>
+#include <optional>
+#include <string>
+
+#define TINYGLTF_IMPLEMENTATION
+// images are decoded after parsing, once it is known they are not resident
+#define TINYGLTF_NO_EXTERNAL_IMAGE
+#define STB_IMAGE_WRITE_IMPLEMENTATION
+#define TINYGLTF_NOEXCEPTION
+#define JSON_NOEXCEPTION
+#include <tiny_gltf.h>
+
+#include <external/stb_image.h>
+
+using namespace pdx;
+
+// tinygltf keeps its own copy of every buffer and conversion reads from
+// that, the file itself is only mapped while it is parsed
+static auto LoadModel(tinygltf::Model& model, const std::filesystem::path& path)
+    -> bool {
+  uint64_t start = SDL_GetPerformanceCounter();
+
+  tinygltf::TinyGLTF loader;
+  std::string err;
+  std::string warn;
+  std::string file = path.string();
+  std::string baseDir = path.parent_path().string();
+
+  bool res = false;
+  auto mapped = pdx::MappedFile::Open(path);
+  if (!mapped.has_value()) {
+    err = "File open error : " + file;
+  } else if (path.extension() == ".glb") {
+    res = loader.LoadBinaryFromMemory(&model, &err, &warn, mapped->Data(),
+                                      (unsigned int)mapped->Size(), baseDir);
+  } else {
+    res = loader.LoadASCIIFromString(&model, &err, &warn,
+                                     (const char *)mapped->Data(),
+                                     (unsigned int)mapped->Size(), baseDir);
+  }
+
+  if (!warn.empty()) {
+    std::cout << "WARN: " << warn << std::endl;
+  }
+
+  if (!err.empty()) {
+    std::cout << "ERR: " << err << std::endl;
+  }
+
+  if (!res) {
+    std::cout << "Failed to load glTF: " << file << std::endl;
+  } else {
+    double ms = (double)(SDL_GetPerformanceCounter() - start) * 1000.0 /
+                (double)SDL_GetPerformanceFrequency();
+    std::cout << "Loaded glTF: " << file << " (" << ms << " ms, peak RSS "
+              << pdx::PeakResidentBytes() / (1024 * 1024) << " MiB)"
+              << std::endl;
+  }
+
+  return res;
+}
+
+static auto ElapsedMs(uint64_t start) -> double {
+  return (double)(SDL_GetPerformanceCounter() - start) * 1000.0 /
+         (double)SDL_GetPerformanceFrequency();
+}
+
+// images are referenced by uri, decode the ones that are not resident yet
+// here so the render thread only has to copy pixels
+static auto PrepareTextures(MeshAsset& asset,
+                            const std::filesystem::path& baseDir) -> void {
+  pdx::TextureCache& cache = pdx::TextureCache::Get();
+  asset.textureKeys.clear();
+  asset.residentTextures.clear();
+  for (auto& texture : asset.textures) {
+    asset.textureKeys.push_back(pdx::TextureCache::KeyFor(texture, baseDir));
+    asset.residentTextures.push_back(cache.Find(asset.textureKeys.back()));
+    if (asset.residentTextures.back() != nullptr) {
+      std::vector<uint8_t>().swap(texture.pixels);
+      continue;
+    }
+    if (!texture.pixels.empty() || texture.uri.empty()) {
+      continue;
+    }
+    std::string file = (baseDir / texture.uri).string();
+    if (std::filesystem::path(texture.uri).extension() == ".ktx2") {
+      auto mapped = pdx::MappedFile::Open(file);
+      if (!mapped.has_value() ||
+          !pdx::Ktx2::Read(mapped->Data(), mapped->Size(), texture)) {
+        std::cout << "Failed to load texture: " << file << std::endl;
+      }
+      continue;
+    }
+    int width, height, components;
+    stbi_uc *pixels = stbi_load(file.c_str(), &width, &height, &components, 0);
+    if (pixels == nullptr) {
+      std::cout << "Failed to load texture: " << file << std::endl;
+      continue;
+    }
+    texture.width = width;
+    texture.height = height;
+    texture.components = components;
+    texture.bits = 8;
+    texture.pixels.assign(pixels, pixels + (size_t)width * height * components);
+    stbi_image_free(pixels);
+  }
+}
+
+auto MeshAsset::View() const -> pdx::MeshView {
+  pdx::MeshView view = cooked.has_value() ? cooked->view : data.View();
+  view.textures = textures;
+  if (!data.quantizedVertices.empty()) {
+    view.vertices = {};
+    view.quantizedVertices = data.quantizedVertices;
+    view.dequantization = data.dequantization;
+  }
+  return view;
+}
+
+auto MeshAsset::Optimize() -> void {
+  if (cooked.has_value() || data.vertices.empty()) {
+    return;
+  }
+  pdx::MeshOptimize::Report report = pdx::MeshOptimize::Optimize(data);
+  size_t lods = pdx::MeshOptimize::BuildLods(data);
+  std::cout << "Optimized " << path.string() << ": ACMR "
+            << report.before.acmr << " -> " << report.after.acmr << ", ATVR "
+            << report.before.atvr << " -> " << report.after.atvr << ", "
+            << lods << " LOD levels" << std::endl;
+}
+
+auto MeshAsset::ReleaseGeometry() -> void {
+  cooked.reset();
+  data = pdx::MeshData();
+}
+
+auto MeshAsset::Quantize() -> size_t {
+  pdx::MeshView view = View();
+  if (view.vertices.empty()) {
+    return 0;
+  }
+  data.dequantization =
+      pdx::MeshData::Quantize(view.vertices, data.quantizedVertices);
+  // cooked vertices stay in the mapping, converted ones can go
+  std::vector<pdx::Vertex>().swap(data.vertices);
+  return view.vertices.size() *
+         (sizeof(pdx::Vertex) - sizeof(pdx::QuantizedVertex));
+}
+
+auto MeshAsset::FromGLTF(const std::filesystem::path& path)
+    -> std::optional<MeshAsset> {
+  tinygltf::Model model;
+  if (!LoadModel(model, path)) {
+    return {};
+  }
+
+  uint64_t start = SDL_GetPerformanceCounter();
+  MeshAsset asset;
+  asset.path = path;
+  asset.data = pdx::MeshData::FromGLTF(model);
+  asset.textures = std::move(asset.data.textures);
+  PrepareTextures(asset, path.parent_path());
+  std::cout << "Converted glTF: " << path.string() << " (" << ElapsedMs(start)
+            << " ms)" << std::endl;
+  return std::make_optional(std::move(asset));
+}
+
+static auto AssetFromCooked(pdx::MeshFile::CookedMesh mesh,
+                            const std::filesystem::path& path,
+                            uint64_t start) -> MeshAsset {
+  MeshAsset asset;
+  asset.path = path;
+  asset.textures = mesh.textures;
+  asset.cooked = std::move(mesh);
+  PrepareTextures(asset, path.parent_path());
+  std::cout << "Loaded cooked mesh: " << path.string() << " ("
+            << ElapsedMs(start) << " ms, peak RSS "
+            << pdx::PeakResidentBytes() / (1024 * 1024) << " MiB)"
+            << std::endl;
+  return asset;
+}
+
+auto MeshAsset::FromCooked(const std::filesystem::path& path)
+    -> std::optional<MeshAsset> {
+  uint64_t start = SDL_GetPerformanceCounter();
+  auto mesh = pdx::MeshFile::Read(path);
+  if (!mesh.has_value()) {
+    return {};
+  }
+  return std::make_optional(AssetFromCooked(std::move(*mesh), path, start));
+}
+
+auto MeshAsset::CookedPath(const std::filesystem::path& file)
+    -> std::filesystem::path {
+  return std::filesystem::path(file).replace_extension(".pdxmesh");
+}
+
+auto MeshAsset::Load(const std::filesystem::path& path)
+    -> std::optional<MeshAsset> {
+  uint64_t start = SDL_GetPerformanceCounter();
+  std::filesystem::path cooked = CookedPath(path);
+  std::error_code ec;
+  if (std::filesystem::exists(cooked, ec)) {
+    // timestamps do not survive copying data/ around, compare contents
+    auto mesh = pdx::MeshFile::Read(cooked);
+    if (mesh.has_value()) {
+      uint64_t sourceHash = pdx::MeshFile::HashSources(path, mesh->sources);
+      if (sourceHash == 0 || sourceHash == mesh->sourceHash) {
+        return std::make_optional(
+            AssetFromCooked(std::move(*mesh), cooked, start));
+      }
+    }
+    std::cout << "Cooked mesh is stale: " << cooked.string() << std::endl;
+  }
+  return FromGLTF(path);
+}
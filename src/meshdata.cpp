@@ -0,0 +1,650 @@
+#include "meshdata.hpp"
+
+#include <glm/ext/matrix_transform.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include <glm/gtc/type_ptr.hpp>
+#include <glm/matrix.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <limits>
+
+#include <tiny_gltf.h>
+
+using namespace pdx;
+
+static_assert(sizeof(Vertex) == 56, "Vertex must stay tightly packed");
+static_assert(std::is_trivially_copyable_v<MeshPacket>);
+static_assert(sizeof(QuantizedVertex) == 24,
+              "QuantizedVertex must stay tightly packed");
+static_assert(sizeof(Dequantization) == 64);
+
+// extensions whose data FromGLTF understands, anything else that a file
+// requires is reported and ignored
+static const char *SUPPORTED_EXTENSIONS[] = {"KHR_mesh_quantization"};
+
+auto MeshData::View() const -> MeshView {
+  return MeshView{vertices,          indices,        packets, nodes, textures,
+                  quantizedVertices, dequantization, lods};
+}
+
+static auto Snorm16(float value) -> int16_t {
+  return (int16_t)std::round(std::clamp(value, -1.0f, 1.0f) * 32767.0f);
+}
+
+static auto Unorm16(float value) -> uint16_t {
+  return (uint16_t)std::round(std::clamp(value, 0.0f, 1.0f) * 65535.0f);
+}
+
+// octahedral mapping of a unit vector to [-1, 1]^2
+static auto OctEncode(glm::vec3 n) -> glm::vec2 {
+  n /= std::max(std::abs(n.x) + std::abs(n.y) + std::abs(n.z), 1e-20f);
+  glm::vec2 p(n.x, n.y);
+  if (n.z < 0.0f) {
+    glm::vec2 sign(p.x >= 0.0f ? 1.0f : -1.0f, p.y >= 0.0f ? 1.0f : -1.0f);
+    p = (1.0f - glm::abs(glm::vec2(p.y, p.x))) * sign;
+  }
+  return p;
+}
+
+auto MeshData::Quantize(std::span<const pdx::Vertex> vertices,
+                        std::vector<pdx::QuantizedVertex>& quantized)
+    -> pdx::Dequantization {
+  glm::vec3 positionMin(std::numeric_limits<float>::max());
+  glm::vec3 positionMax(std::numeric_limits<float>::lowest());
+  glm::vec4 texcoordMin(std::numeric_limits<float>::max());
+  glm::vec4 texcoordMax(std::numeric_limits<float>::lowest());
+  for (const Vertex& vertex : vertices) {
+    positionMin = glm::min(positionMin, vertex.position);
+    positionMax = glm::max(positionMax, vertex.position);
+    glm::vec4 texcoords(vertex.texcoord0, vertex.texcoord1);
+    texcoordMin = glm::min(texcoordMin, texcoords);
+    texcoordMax = glm::max(texcoordMax, texcoords);
+  }
+  if (vertices.empty()) {
+    positionMin = positionMax = glm::vec3(0.0f);
+    texcoordMin = texcoordMax = glm::vec4(0.0f);
+  }
+
+  // flat meshes still need a non zero scale to divide by
+  glm::vec3 center = (positionMin + positionMax) * 0.5f;
+  glm::vec3 extent = glm::max((positionMax - positionMin) * 0.5f,
+                              glm::vec3(1e-6f));
+  glm::vec4 texcoordExtent =
+      glm::max(texcoordMax - texcoordMin, glm::vec4(1e-6f));
+
+  quantized.resize(vertices.size());
+  for (size_t i = 0; i < vertices.size(); ++i) {
+    const Vertex& vertex = vertices[i];
+    QuantizedVertex& out = quantized[i];
+    glm::vec3 position = (vertex.position - center) / extent;
+    out.position[0] = Snorm16(position.x);
+    out.position[1] = Snorm16(position.y);
+    out.position[2] = Snorm16(position.z);
+    out.position[3] = vertex.tangent.w < 0.0f ? -32767 : 32767;
+
+    glm::vec2 normal = OctEncode(vertex.normal);
+    out.normal[0] = Snorm16(normal.x);
+    out.normal[1] = Snorm16(normal.y);
+    glm::vec2 tangent = OctEncode(glm::vec3(vertex.tangent));
+    out.tangent[0] = Snorm16(tangent.x);
+    out.tangent[1] = Snorm16(tangent.y);
+
+    glm::vec4 texcoords =
+        (glm::vec4(vertex.texcoord0, vertex.texcoord1) - texcoordMin) /
+        texcoordExtent;
+    out.texcoord0[0] = Unorm16(texcoords.x);
+    out.texcoord0[1] = Unorm16(texcoords.y);
+    out.texcoord1[0] = Unorm16(texcoords.z);
+    out.texcoord1[1] = Unorm16(texcoords.w);
+  }
+
+  return Dequantization{
+      glm::vec4(extent, 1.0f), glm::vec4(center, 0.0f),
+      {glm::vec4(texcoordExtent.x, texcoordExtent.y, texcoordMin.x,
+                 texcoordMin.y),
+       glm::vec4(texcoordExtent.z, texcoordExtent.w, texcoordMin.z,
+                 texcoordMin.w)}};
+}
+
+static auto ReadComponent(const uint8_t *p, int componentType,
+                          bool normalized) -> float {
+  switch (componentType) {
+  case TINYGLTF_COMPONENT_TYPE_BYTE: {
+    int8_t v;
+    memcpy(&v, p, sizeof(v));
+    return normalized ? std::max(v / 127.0f, -1.0f) : (float)v;
+  }
+  case TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE: {
+    uint8_t v;
+    memcpy(&v, p, sizeof(v));
+    return normalized ? v / 255.0f : (float)v;
+  }
+  case TINYGLTF_COMPONENT_TYPE_SHORT: {
+    int16_t v;
+    memcpy(&v, p, sizeof(v));
+    return normalized ? std::max(v / 32767.0f, -1.0f) : (float)v;
+  }
+  case TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT: {
+    uint16_t v;
+    memcpy(&v, p, sizeof(v));
+    return normalized ? v / 65535.0f : (float)v;
+  }
+  case TINYGLTF_COMPONENT_TYPE_UNSIGNED_INT: {
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+    return (float)v;
+  }
+  case TINYGLTF_COMPONENT_TYPE_FLOAT: {
+    float v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+  }
+  default:
+    return 0.0f;
+  }
+}
+
+static auto ComponentSize(int componentType) -> size_t {
+  switch (componentType) {
+  case TINYGLTF_COMPONENT_TYPE_BYTE:
+  case TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE:
+    return 1;
+  case TINYGLTF_COMPONENT_TYPE_SHORT:
+  case TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT:
+    return 2;
+  default:
+    return 4;
+  }
+}
+
+// Reads up to components floats per element of accessor into dst, writing
+// element i to dst + i * dstStride
+static auto ReadAccessor(const tinygltf::Model& model, int accessorIndex,
+                         int components, float *dst, size_t dstStride)
+    -> void {
+  const tinygltf::Accessor& accessor = model.accessors[accessorIndex];
+  if (accessor.bufferView < 0) {
+    return;
+  }
+  const tinygltf::BufferView& view = model.bufferViews[accessor.bufferView];
+  const uint8_t *base = model.buffers[view.buffer].data.data() +
+                        view.byteOffset + accessor.byteOffset;
+  int stride = accessor.ByteStride(view);
+  if (stride <= 0) {
+    return;
+  }
+  int count = accessor.type == TINYGLTF_TYPE_SCALAR ? 1 : accessor.type;
+  count = std::min(count, components);
+  size_t componentSize = ComponentSize(accessor.componentType);
+
+  for (size_t i = 0; i < accessor.count; ++i) {
+    const uint8_t *element = base + i * stride;
+    float *out = dst + i * dstStride;
+    for (int c = 0; c < count; ++c) {
+      out[c] = ReadComponent(element + c * componentSize,
+                             accessor.componentType, accessor.normalized);
+    }
+  }
+}
+
+static auto ReadIndices(const tinygltf::Model& model, int accessorIndex,
+                        std::vector<uint32_t>& indices) -> void {
+  const tinygltf::Accessor& accessor = model.accessors[accessorIndex];
+  const tinygltf::BufferView& view = model.bufferViews[accessor.bufferView];
+  const uint8_t *base = model.buffers[view.buffer].data.data() +
+                        view.byteOffset + accessor.byteOffset;
+  int stride = accessor.ByteStride(view);
+  for (size_t i = 0; i < accessor.count; ++i) {
+    const uint8_t *element = base + i * stride;
+    switch (accessor.componentType) {
+    case TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE:
+      indices.push_back(*element);
+      break;
+    case TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT: {
+      uint16_t v;
+      memcpy(&v, element, sizeof(v));
+      indices.push_back(v);
+      break;
+    }
+    default: {
+      uint32_t v;
+      memcpy(&v, element, sizeof(v));
+      indices.push_back(v);
+      break;
+    }
+    }
+  }
+}
+
+static auto NodeTransform(const tinygltf::Node& node) -> glm::mat4 {
+  if (node.matrix.size() == 16) {
+    return glm::mat4(glm::make_mat4(node.matrix.data()));
+  }
+  glm::mat4 transform(1.0f);
+  if (node.translation.size() == 3) {
+    transform = glm::translate(transform, glm::vec3(node.translation[0],
+                                                    node.translation[1],
+                                                    node.translation[2]));
+  }
+  if (node.rotation.size() == 4) {
+    // glTF stores quaternions as x, y, z, w
+    transform *= glm::mat4_cast(
+        glm::fquat((float)node.rotation[3], (float)node.rotation[0],
+                   (float)node.rotation[1], (float)node.rotation[2]));
+  }
+  if (node.scale.size() == 3) {
+    transform = glm::scale(
+        transform, glm::vec3(node.scale[0], node.scale[1], node.scale[2]));
+  }
+  return transform;
+}
+
+static auto AppendPrimitive(MeshData& mesh, const tinygltf::Model& model,
+                            const tinygltf::Primitive& primitive,
+                            const glm::mat4& transform) -> void {
+  auto position = primitive.attributes.find("POSITION");
+  if (position == primitive.attributes.end()) {
+    return;
+  }
+  size_t vertexCount = model.accessors[position->second].count;
+  size_t baseVertex = mesh.vertices.size();
+  mesh.vertices.resize(baseVertex + vertexCount,
+                       Vertex{glm::vec3(0.0f), glm::vec3(0.0f, 0.0f, 1.0f),
+                              glm::vec4(1.0f, 0.0f, 0.0f, 1.0f),
+                              glm::vec2(0.0f), glm::vec2(0.0f)});
+  Vertex *vertices = mesh.vertices.data() + baseVertex;
+  constexpr size_t stride = sizeof(Vertex) / sizeof(float);
+
+  for (const auto& [name, accessor] : primitive.attributes) {
+    if (model.accessors[accessor].count != vertexCount) {
+      std::cout << "attribute count mismatch: " << name << std::endl;
+      continue;
+    }
+    if (name == "POSITION") {
+      ReadAccessor(model, accessor, 3, &vertices->position.x, stride);
+    } else if (name == "NORMAL") {
+      ReadAccessor(model, accessor, 3, &vertices->normal.x, stride);
+    } else if (name == "TANGENT") {
+      ReadAccessor(model, accessor, 4, &vertices->tangent.x, stride);
+    } else if (name == "TEXCOORD_0") {
+      ReadAccessor(model, accessor, 2, &vertices->texcoord0.x, stride);
+    } else if (name == "TEXCOORD_1") {
+      ReadAccessor(model, accessor, 2, &vertices->texcoord1.x, stride);
+    } else {
+      std::cout << "vaa missing: " << name << std::endl;
+    }
+  }
+
+  // every node gets its own copy of the primitive, so the node transform is
+  // baked into the vertices and the model matrix is all a draw needs
+  uint32_t mode =
+      primitive.mode < 0 ? TINYGLTF_MODE_TRIANGLES : (uint32_t)primitive.mode;
+  glm::mat3 linear(transform);
+  bool mirrored = glm::determinant(linear) < 0.0f;
+  if (transform != glm::mat4(1.0f)) {
+    glm::mat3 normalMatrix = glm::transpose(glm::inverse(linear));
+    for (size_t i = 0; i < vertexCount; ++i) {
+      Vertex& vertex = vertices[i];
+      vertex.position = glm::vec3(transform * glm::vec4(vertex.position, 1.0f));
+      vertex.normal = glm::normalize(normalMatrix * vertex.normal);
+      // a mirroring transform flips the bitangent's handedness
+      vertex.tangent =
+          glm::vec4(glm::normalize(linear * glm::vec3(vertex.tangent)),
+                    mirrored ? -vertex.tangent.w : vertex.tangent.w);
+    }
+  }
+
+  size_t firstIndex = mesh.indices.size();
+  if (primitive.indices >= 0) {
+    ReadIndices(model, primitive.indices, mesh.indices);
+  } else {
+    for (size_t i = 0; i < vertexCount; ++i) {
+      mesh.indices.push_back((uint32_t)i);
+    }
+  }
+  // mirroring also turns front faces into back faces
+  if (mirrored && mode == TINYGLTF_MODE_TRIANGLES) {
+    for (size_t i = firstIndex; i + 2 < mesh.indices.size(); i += 3) {
+      std::swap(mesh.indices[i + 1], mesh.indices[i + 2]);
+    }
+  }
+
+  MeshPacket packet;
+  packet.mode = mode;
+  packet.firstIndex = (uint32_t)firstIndex;
+  packet.indexCount = (uint32_t)(mesh.indices.size() - firstIndex);
+  packet.baseVertex = (int32_t)baseVertex;
+  packet.material = primitive.material;
+  packet.boundsMin = glm::vec3(std::numeric_limits<float>::max());
+  packet.boundsMax = glm::vec3(std::numeric_limits<float>::lowest());
+  for (size_t i = 0; i < vertexCount; ++i) {
+    packet.boundsMin = glm::min(packet.boundsMin, vertices[i].position);
+    packet.boundsMax = glm::max(packet.boundsMax, vertices[i].position);
+  }
+  packet.firstLod = 0;
+  packet.lodCount = 0;
+  mesh.packets.push_back(packet);
+}
+
+static auto AppendNode(MeshData& mesh, const tinygltf::Model& model,
+                       const tinygltf::Node& node, const glm::mat4& parent)
+    -> void {
+  glm::mat4 transform = parent * NodeTransform(node);
+
+  if ((node.mesh >= 0) && (node.mesh < model.meshes.size())) {
+    for (const auto& primitive : model.meshes[node.mesh].primitives) {
+      AppendPrimitive(mesh, model, primitive, transform);
+    }
+  }
+
+  for (size_t i = 0; i < node.children.size(); ++i) {
+    assert((node.children[i] >= 0) && (node.children[i] < model.nodes.size()));
+    AppendNode(mesh, model, model.nodes[node.children[i]], transform);
+  }
+}
+
+auto MeshData::FromGLTF(const tinygltf::Model& model) -> MeshData {
+  MeshData mesh;
+
+  // KHR_mesh_quantization only allows integer attribute types, which
+  // ReadAccessor converts like any other accessor
+  for (const auto& extension : model.extensionsRequired) {
+    if (std::find(std::begin(SUPPORTED_EXTENSIONS),
+                  std::end(SUPPORTED_EXTENSIONS),
+                  extension) == std::end(SUPPORTED_EXTENSIONS)) {
+      std::cout << "Unsupported required extension: " << extension
+                << std::endl;
+    }
+  }
+
+  int sceneIndex = model.defaultScene < 0 ? 0 : model.defaultScene;
+  if (sceneIndex < model.scenes.size()) {
+    const tinygltf::Scene& scene = model.scenes[sceneIndex];
+    for (size_t i = 0; i < scene.nodes.size(); ++i) {
+      assert((scene.nodes[i] >= 0) && (scene.nodes[i] < model.nodes.size()));
+      const tinygltf::Node& node = model.nodes[scene.nodes[i]];
+      uint32_t first = (uint32_t)mesh.packets.size();
+      AppendNode(mesh, model, node, glm::mat4(1.0f));
+      mesh.nodes.push_back(
+          MeshNode{node.name, first, (uint32_t)mesh.packets.size() - first});
+    }
+  }
+
+  // textures only used for normals, occlusion or metal/roughness hold linear
+  // data, everything else is color and stored as sRGB
+  std::vector<bool> color(model.textures.size(), false);
+  std::vector<bool> data(model.textures.size(), false);
+  for (const auto& material : model.materials) {
+    for (int index : {material.pbrMetallicRoughness.baseColorTexture.index,
+                      material.emissiveTexture.index}) {
+      if (index >= 0 && index < color.size()) {
+        color[index] = true;
+      }
+    }
+    for (int index :
+         {material.normalTexture.index, material.occlusionTexture.index,
+          material.pbrMetallicRoughness.metallicRoughnessTexture.index}) {
+      if (index >= 0 && index < data.size()) {
+        data[index] = true;
+      }
+    }
+  }
+
+  for (size_t i = 0; i < model.textures.size(); ++i) {
+    const tinygltf::Texture& texture = model.textures[i];
+    MeshTexture out{};
+    out.srgb = color[i] || !data[i];
+    // everything gets a mip chain, so trilinear is the sensible default
+    out.minFilter = TINYGLTF_TEXTURE_FILTER_LINEAR_MIPMAP_LINEAR;
+    out.magFilter = TINYGLTF_TEXTURE_FILTER_LINEAR;
+    out.wrapS = TINYGLTF_TEXTURE_WRAP_REPEAT;
+    out.wrapT = TINYGLTF_TEXTURE_WRAP_REPEAT;
+    if (texture.sampler >= 0) {
+      const tinygltf::Sampler& sampler = model.samplers[texture.sampler];
+      if (sampler.minFilter >= 0) {
+        out.minFilter = sampler.minFilter;
+      }
+      if (sampler.magFilter >= 0) {
+        out.magFilter = sampler.magFilter;
+      }
+      out.wrapS = sampler.wrapS;
+      out.wrapT = sampler.wrapT;
+    }
+    if (texture.source >= 0) {
+      const tinygltf::Image& image = model.images[texture.source];
+      out.uri = image.uri;
+      out.width = image.width;
+      out.height = image.height;
+      out.components = image.component;
+      out.bits = image.bits;
+      out.pixels.assign(image.image.begin(), image.image.end());
+    }
+    mesh.textures.push_back(std::move(out));
+  }
+
+  return mesh;
+}
+
+static auto AlignUp(uint64_t value) -> uint64_t {
+  return (value + MeshFile::ALIGNMENT - 1) / MeshFile::ALIGNMENT *
+         MeshFile::ALIGNMENT;
+}
+
+// continues the FNV-1a hash over the contents of path, 0 if it cannot be
+// read
+static auto HashInto(uint64_t hash, const std::filesystem::path& path)
+    -> uint64_t {
+  auto file = MappedFile::Open(path);
+  if (!file.has_value()) {
+    return 0;
+  }
+  for (size_t i = 0; i < file->Size(); ++i) {
+    hash ^= file->Data()[i];
+    hash *= 0x100000001b3ull;
+  }
+  return hash;
+}
+
+auto MeshFile::HashFile(const std::filesystem::path& path) -> uint64_t {
+  return HashInto(0xcbf29ce484222325ull, path);
+}
+
+auto MeshFile::HashSources(const std::filesystem::path& gltf,
+                           std::span<const std::string> sources) -> uint64_t {
+  uint64_t hash = HashFile(gltf);
+  for (const auto& source : sources) {
+    if (hash == 0) {
+      break;
+    }
+    hash = HashInto(hash, gltf.parent_path() / source);
+  }
+  return hash;
+}
+
+auto MeshFile::Write(const std::filesystem::path& path, const MeshView& mesh,
+                     uint64_t sourceHash, std::span<const std::string> sources)
+    -> bool {
+  std::string strings;
+  std::vector<NodeRecord> nodes;
+  for (const auto& node : mesh.nodes) {
+    nodes.push_back(NodeRecord{(uint32_t)strings.size(),
+                               (uint32_t)node.name.size(), node.firstPacket,
+                               node.packetCount});
+    strings += node.name;
+  }
+  std::vector<TextureRecord> textures;
+  for (const auto& texture : mesh.textures) {
+    if (texture.uri.empty()) {
+      std::cout << "WARN: embedded images are not cooked" << std::endl;
+    }
+    textures.push_back(TextureRecord{
+        (uint32_t)strings.size(), (uint32_t)texture.uri.size(),
+        texture.minFilter, texture.magFilter, texture.wrapS, texture.wrapT,
+        texture.srgb ? TEXTURE_SRGB : 0u});
+    strings += texture.uri;
+  }
+  std::vector<SourceRecord> sourceRecords;
+  for (const auto& source : sources) {
+    sourceRecords.push_back(
+        SourceRecord{(uint32_t)strings.size(), (uint32_t)source.size()});
+    strings += source;
+  }
+
+  std::span<const std::byte> blobs[SECTION_COUNT] = {
+      std::as_bytes(mesh.vertices), std::as_bytes(mesh.indices),
+      std::as_bytes(mesh.packets),  std::as_bytes(std::span(nodes)),
+      std::as_bytes(std::span(textures)),
+      std::as_bytes(std::span(strings.data(), strings.size())),
+      std::as_bytes(mesh.lods), std::as_bytes(std::span(sourceRecords))};
+
+  Header header{};
+  header.magic = MAGIC;
+  header.version = VERSION;
+  header.vertexSize = sizeof(Vertex);
+  header.packetSize = sizeof(MeshPacket);
+  header.sourceHash = sourceHash;
+  uint64_t offset = AlignUp(sizeof(Header));
+  for (uint32_t i = 0; i < SECTION_COUNT; ++i) {
+    header.sections[i] = Range{offset, blobs[i].size()};
+    offset = AlignUp(offset + blobs[i].size());
+  }
+
+  std::ofstream file(path, std::ios::binary | std::ios::trunc);
+  if (!file) {
+    return false;
+  }
+  static const char padding[ALIGNMENT] = {};
+  file.write((const char *)&header, sizeof(header));
+  uint64_t written = sizeof(header);
+  for (uint32_t i = 0; i < SECTION_COUNT; ++i) {
+    file.write(padding, header.sections[i].offset - written);
+    file.write((const char *)blobs[i].data(), blobs[i].size());
+    written = header.sections[i].offset + blobs[i].size();
+  }
+  return (bool)file;
+}
+
+template <typename T>
+static auto SectionSpan(const MappedFile& file, const MeshFile::Range& range)
+    -> std::span<const T> {
+  return std::span<const T>(
+      reinterpret_cast<const T *>(file.Data() + range.offset),
+      range.size / sizeof(T));
+}
+
+// whether indices [first, first + count) lie in the index section and, with
+// baseVertex added, only reference vertices of the vertex section
+static auto ValidIndexRange(const MeshView& mesh, uint64_t first,
+                            uint64_t count, int32_t baseVertex) -> bool {
+  if (first + count > mesh.indices.size()) {
+    return false;
+  }
+  uint32_t highest = 0;
+  for (uint32_t index : mesh.indices.subspan(first, count)) {
+    highest = std::max(highest, index);
+  }
+  return count == 0 || (uint64_t)baseVertex + highest < mesh.vertices.size();
+}
+
+// cross references between the sections, a file that passes can be drawn
+// without reading outside of its own data
+static auto ValidRanges(const MeshView& mesh) -> bool {
+  for (const MeshNode& node : mesh.nodes) {
+    if ((uint64_t)node.firstPacket + node.packetCount > mesh.packets.size()) {
+      return false;
+    }
+  }
+  for (const MeshLod& lod : mesh.lods) {
+    if ((uint64_t)lod.firstIndex + lod.indexCount > mesh.indices.size()) {
+      return false;
+    }
+  }
+  for (const MeshPacket& packet : mesh.packets) {
+    if (packet.baseVertex < 0 ||
+        !ValidIndexRange(mesh, packet.firstIndex, packet.indexCount,
+                         packet.baseVertex) ||
+        (uint64_t)packet.firstLod + packet.lodCount > mesh.lods.size()) {
+      return false;
+    }
+    for (uint32_t i = 0; i < packet.lodCount; ++i) {
+      const MeshLod& lod = mesh.lods[packet.firstLod + i];
+      if (!ValidIndexRange(mesh, lod.firstIndex, lod.indexCount,
+                           packet.baseVertex)) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+auto MeshFile::Read(const std::filesystem::path& path)
+    -> std::optional<CookedMesh> {
+  auto file = MappedFile::Open(path);
+  if (!file.has_value() || file->Size() < sizeof(Header)) {
+    return {};
+  }
+
+  Header header;
+  memcpy(&header, file->Data(), sizeof(header));
+  if (header.magic != MAGIC || header.version != VERSION ||
+      header.vertexSize != sizeof(Vertex) ||
+      header.packetSize != sizeof(MeshPacket)) {
+    std::cout << "Outdated or invalid mesh file: " << path << std::endl;
+    return {};
+  }
+  for (const auto& range : header.sections) {
+    if (range.offset % ALIGNMENT != 0 || range.offset > file->Size() ||
+        range.size > file->Size() - range.offset) {
+      std::cout << "Corrupt mesh file: " << path << std::endl;
+      return {};
+    }
+  }
+
+  CookedMesh mesh{std::move(*file), header.sourceHash};
+  const MappedFile& mapped = mesh.file;
+  auto strings = SectionSpan<char>(mapped, header.sections[STRINGS]);
+  auto string = [&](uint32_t offset, uint32_t length) {
+    if (offset > strings.size() || length > strings.size() - offset) {
+      return std::string();
+    }
+    return std::string(strings.data() + offset, length);
+  };
+
+  for (const auto& node :
+       SectionSpan<NodeRecord>(mapped, header.sections[NODES])) {
+    mesh.nodes.push_back(MeshNode{string(node.nameOffset, node.nameLength),
+                                  node.firstPacket, node.packetCount});
+  }
+  for (const auto& texture :
+       SectionSpan<TextureRecord>(mapped, header.sections[TEXTURES])) {
+    MeshTexture out{};
+    out.uri = string(texture.uriOffset, texture.uriLength);
+    out.minFilter = texture.minFilter;
+    out.magFilter = texture.magFilter;
+    out.wrapS = texture.wrapS;
+    out.wrapT = texture.wrapT;
+    out.srgb = (texture.flags & TEXTURE_SRGB) != 0;
+    mesh.textures.push_back(std::move(out));
+  }
+  for (const auto& source :
+       SectionSpan<SourceRecord>(mapped, header.sections[SOURCES])) {
+    mesh.sources.push_back(string(source.uriOffset, source.uriLength));
+  }
+
+  mesh.view.vertices = SectionSpan<Vertex>(mapped, header.sections[VERTICES]);
+  mesh.view.indices = SectionSpan<uint32_t>(mapped, header.sections[INDICES]);
+  mesh.view.packets =
+      SectionSpan<MeshPacket>(mapped, header.sections[PACKETS]);
+  mesh.view.lods = SectionSpan<MeshLod>(mapped, header.sections[LODS]);
+  mesh.view.nodes = mesh.nodes;
+  mesh.view.textures = mesh.textures;
+  if (!ValidRanges(mesh.view)) {
+    std::cout << "Corrupt mesh file: " << path << std::endl;
+    return {};
+  }
+  return std::make_optional(std::move(mesh));
+}
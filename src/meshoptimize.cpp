@@ -0,0 +1,793 @@
+#include "meshoptimize.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+#include <tuple>
+#include <vector>
+
+using namespace pdx;
+
+// glTF / GL_TRIANGLES
+constexpr uint32_t MODE_TRIANGLES = 4;
+
+// Forsyth's scoring constants, the cache modelled while optimizing is larger
+// than the one the statistics use so the order degrades gracefully on GPUs
+// with bigger caches
+constexpr int FORSYTH_CACHE_SIZE = 32;
+constexpr float CACHE_DECAY_POWER = 1.5f;
+constexpr float LAST_TRIANGLE_SCORE = 0.75f;
+constexpr float VALENCE_BOOST_SCALE = 2.0f;
+constexpr float VALENCE_BOOST_POWER = 0.5f;
+
+constexpr size_t CACHE_LINE = 64;
+constexpr size_t CACHE_LINES = 64;
+
+static auto VertexScore(int cachePosition, uint32_t liveTriangles) -> float {
+  if (liveTriangles == 0) {
+    return -1.0f;
+  }
+  float score = 0.0f;
+  if (cachePosition >= 0) {
+    if (cachePosition < 3) {
+      // the last triangle's vertices, deliberately not the best choice so
+      // strips do not form
+      score = LAST_TRIANGLE_SCORE;
+    } else {
+      float scale = 1.0f / (FORSYTH_CACHE_SIZE - 3);
+      score = std::pow(1.0f - (cachePosition - 3) * scale, CACHE_DECAY_POWER);
+    }
+  }
+  // vertices with few triangles left get finished off first
+  score += VALENCE_BOOST_SCALE *
+           std::pow((float)liveTriangles, -VALENCE_BOOST_POWER);
+  return score;
+}
+
+// FIFO post transform cache, a vertex is cached while fewer than size misses
+// happened since it was loaded
+struct FifoCache {
+  std::vector<uint32_t> loaded;
+  uint32_t size;
+  uint32_t time;
+
+  FifoCache(size_t vertexCount, uint32_t cacheSize)
+      : loaded(vertexCount, 0), size(cacheSize), time(cacheSize + 1) {}
+
+  // true on a miss
+  auto Access(uint32_t vertex) -> bool {
+    if (time - loaded[vertex] < size) {
+      return false;
+    }
+    loaded[vertex] = time++;
+    return true;
+  }
+};
+
+auto MeshOptimize::Analyze(std::span<const uint32_t> indices,
+                           size_t vertexCount, size_t vertexSize,
+                           uint32_t cacheSize) -> Stats {
+  Stats stats{0.0f, 0.0f, 0.0f};
+  if (indices.size() < 3 || vertexCount == 0) {
+    return stats;
+  }
+  FifoCache cache(vertexCount, cacheSize);
+  std::vector<bool> used(vertexCount, false);
+  // fully associative LRU of cache lines, most recent at the back
+  std::vector<size_t> lines;
+  size_t misses = 0;
+  size_t unique = 0;
+  size_t fetched = 0;
+  for (uint32_t index : indices) {
+    if (!used[index]) {
+      used[index] = true;
+      ++unique;
+    }
+    if (!cache.Access(index)) {
+      continue;
+    }
+    ++misses;
+    size_t first = index * vertexSize / CACHE_LINE;
+    size_t last = (index * vertexSize + vertexSize - 1) / CACHE_LINE;
+    for (size_t line = first; line <= last; ++line) {
+      auto it = std::find(lines.begin(), lines.end(), line);
+      if (it != lines.end()) {
+        lines.erase(it);
+      } else {
+        fetched += CACHE_LINE;
+        if (lines.size() == CACHE_LINES) {
+          lines.erase(lines.begin());
+        }
+      }
+      lines.push_back(line);
+    }
+  }
+  stats.acmr = (float)misses / (indices.size() / 3);
+  stats.atvr = (float)misses / unique;
+  stats.overfetch = (float)fetched / (unique * vertexSize);
+  return stats;
+}
+
+// vertex range [first, first + count) used by a packet
+struct PacketVertices {
+  size_t first;
+  size_t count;
+};
+
+static auto VerticesOf(const MeshPacket& packet,
+                       std::span<const uint32_t> indices, size_t vertexCount)
+    -> PacketVertices {
+  uint32_t maxIndex = 0;
+  for (uint32_t index : indices) {
+    maxIndex = std::max(maxIndex, index);
+  }
+  size_t first = (size_t)std::max(packet.baseVertex, 0);
+  if (first + maxIndex >= vertexCount) {
+    // indices past the end of the vertex data, leave the packet alone
+    return PacketVertices{0, 0};
+  }
+  return PacketVertices{first, (size_t)maxIndex + 1};
+}
+
+static auto PacketIndices(const MeshPacket& packet,
+                          std::span<const uint32_t> indices)
+    -> std::span<const uint32_t> {
+  size_t count = packet.indexCount - packet.indexCount % 3;
+  return indices.subspan(packet.firstIndex, count);
+}
+
+auto MeshOptimize::Analyze(const pdx::MeshView& mesh) -> Stats {
+  Stats total{0.0f, 0.0f, 0.0f};
+  size_t triangles = 0;
+  for (const MeshPacket& packet : mesh.packets) {
+    if (packet.mode != MODE_TRIANGLES || packet.indexCount < 3) {
+      continue;
+    }
+    std::span<const uint32_t> indices = PacketIndices(packet, mesh.indices);
+    PacketVertices range = VerticesOf(packet, indices, mesh.vertices.size());
+    if (range.count == 0) {
+      continue;
+    }
+    Stats stats = Analyze(indices, range.count, sizeof(Vertex));
+    size_t count = indices.size() / 3;
+    total.acmr += stats.acmr * count;
+    total.atvr += stats.atvr * count;
+    total.overfetch += stats.overfetch * count;
+    triangles += count;
+  }
+  if (triangles > 0) {
+    total.acmr /= triangles;
+    total.atvr /= triangles;
+    total.overfetch /= triangles;
+  }
+  return total;
+}
+
+auto MeshOptimize::OptimizeVertexCache(std::span<uint32_t> indices,
+                                       size_t vertexCount) -> void {
+  const size_t triangleCount = indices.size() / 3;
+  if (triangleCount < 2 || vertexCount == 0) {
+    return;
+  }
+
+  // triangles of vertex v are adjacency[offsets[v], offsets[v] + live[v]),
+  // emitted ones are swapped behind the live ones
+  std::vector<uint32_t> live(vertexCount, 0);
+  for (size_t i = 0; i < triangleCount * 3; ++i) {
+    ++live[indices[i]];
+  }
+  std::vector<uint32_t> offsets(vertexCount + 1, 0);
+  std::partial_sum(live.begin(), live.end(), offsets.begin() + 1);
+  std::vector<uint32_t> adjacency(triangleCount * 3);
+  {
+    std::vector<uint32_t> fill(offsets.begin(), offsets.end() - 1);
+    for (size_t t = 0; t < triangleCount; ++t) {
+      for (int k = 0; k < 3; ++k) {
+        adjacency[fill[indices[t * 3 + k]]++] = (uint32_t)t;
+      }
+    }
+  }
+
+  std::vector<int> cachePosition(vertexCount, -1);
+  std::vector<float> vertexScore(vertexCount);
+  for (size_t v = 0; v < vertexCount; ++v) {
+    vertexScore[v] = VertexScore(-1, live[v]);
+  }
+  std::vector<float> triangleScore(triangleCount);
+  for (size_t t = 0; t < triangleCount; ++t) {
+    triangleScore[t] = vertexScore[indices[t * 3]] +
+                       vertexScore[indices[t * 3 + 1]] +
+                       vertexScore[indices[t * 3 + 2]];
+  }
+
+  std::vector<bool> emitted(triangleCount, false);
+  std::vector<uint32_t> result;
+  result.reserve(triangleCount * 3);
+  std::vector<uint32_t> cache;
+  std::vector<uint32_t> next;
+  cache.reserve(FORSYTH_CACHE_SIZE + 3);
+  next.reserve(FORSYTH_CACHE_SIZE + 3);
+
+  int64_t best = std::max_element(triangleScore.begin(), triangleScore.end()) -
+                 triangleScore.begin();
+  size_t cursor = 0;
+  while (result.size() < triangleCount * 3) {
+    if (best < 0) {
+      // nothing in the cache has triangles left, continue with the next
+      // unconnected part
+      while (emitted[cursor]) {
+        ++cursor;
+      }
+      best = (int64_t)cursor;
+    }
+
+    const uint32_t *triangle = &indices[best * 3];
+    emitted[best] = true;
+    next.assign(triangle, triangle + 3);
+    for (int k = 0; k < 3; ++k) {
+      uint32_t v = triangle[k];
+      result.push_back(v);
+      uint32_t *begin = &adjacency[offsets[v]];
+      uint32_t *end = begin + live[v];
+      *std::find(begin, end, (uint32_t)best) = *(end - 1);
+      --live[v];
+    }
+    for (uint32_t v : cache) {
+      if (v != next[0] && v != next[1] && v != next[2]) {
+        next.push_back(v);
+      }
+    }
+    // vertices falling out of the cache lose their position bonus
+    for (size_t i = FORSYTH_CACHE_SIZE; i < next.size(); ++i) {
+      cachePosition[next[i]] = -1;
+      vertexScore[next[i]] = VertexScore(-1, live[next[i]]);
+    }
+    next.resize(std::min(next.size(), (size_t)FORSYTH_CACHE_SIZE));
+    for (size_t i = 0; i < next.size(); ++i) {
+      cachePosition[next[i]] = (int)i;
+      vertexScore[next[i]] = VertexScore((int)i, live[next[i]]);
+    }
+    std::swap(cache, next);
+
+    best = -1;
+    float bestScore = -1.0f;
+    for (uint32_t v : cache) {
+      for (uint32_t i = 0; i < live[v]; ++i) {
+        uint32_t t = adjacency[offsets[v] + i];
+        float score = vertexScore[indices[t * 3]] +
+                      vertexScore[indices[t * 3 + 1]] +
+                      vertexScore[indices[t * 3 + 2]];
+        triangleScore[t] = score;
+        if (score > bestScore) {
+          bestScore = score;
+          best = t;
+        }
+      }
+    }
+  }
+
+  std::copy(result.begin(), result.end(), indices.begin());
+}
+
+auto MeshOptimize::OptimizeOverdraw(std::span<uint32_t> indices,
+                                    std::span<const pdx::Vertex> vertices,
+                                    float threshold) -> void {
+  const size_t triangleCount = indices.size() / 3;
+  if (triangleCount < 2) {
+    return;
+  }
+
+  // hard boundaries, the cache was flushed anyway where a triangle misses
+  // with all three vertices
+  std::vector<size_t> hard;
+  {
+    FifoCache cache(vertices.size(), CACHE_SIZE);
+    for (size_t t = 0; t < triangleCount; ++t) {
+      int misses = cache.Access(indices[t * 3]) +
+                   cache.Access(indices[t * 3 + 1]) +
+                   cache.Access(indices[t * 3 + 2]);
+      if (t == 0 || misses == 3) {
+        hard.push_back(t);
+      }
+    }
+    hard.push_back(triangleCount);
+  }
+
+  // soft boundaries inside each hard cluster, cut as soon as the part so far
+  // is cheap enough to start over with a cold cache
+  std::vector<size_t> clusters;
+  for (size_t c = 0; c + 1 < hard.size(); ++c) {
+    size_t begin = hard[c];
+    size_t end = hard[c + 1];
+    std::span<const uint32_t> part =
+        std::span<const uint32_t>(indices).subspan(begin * 3,
+                                                   (end - begin) * 3);
+    float limit =
+        Analyze(part, vertices.size(), sizeof(Vertex)).acmr * threshold;
+
+    FifoCache cache(vertices.size(), CACHE_SIZE);
+    size_t start = begin;
+    size_t misses = 0;
+    clusters.push_back(begin);
+    for (size_t t = begin; t < end; ++t) {
+      misses += cache.Access(indices[t * 3]) +
+                cache.Access(indices[t * 3 + 1]) +
+                cache.Access(indices[t * 3 + 2]);
+      if (t + 1 < end && (float)misses / (t + 1 - start) <= limit) {
+        clusters.push_back(t + 1);
+        cache = FifoCache(vertices.size(), CACHE_SIZE);
+        start = t + 1;
+        misses = 0;
+      }
+    }
+  }
+  clusters.push_back(triangleCount);
+  if (clusters.size() <= 2) {
+    return;
+  }
+
+  // area weighted centroids and normals
+  auto corner = [&](size_t t, int k) {
+    return vertices[indices[t * 3 + k]].position;
+  };
+  glm::vec3 meshCentroid(0.0f);
+  float meshArea = 0.0f;
+  for (size_t t = 0; t < triangleCount; ++t) {
+    glm::vec3 a = corner(t, 0), b = corner(t, 1), c = corner(t, 2);
+    float area = glm::length(glm::cross(b - a, c - a));
+    meshCentroid += (a + b + c) * (area / 3.0f);
+    meshArea += area;
+  }
+  meshCentroid /= std::max(meshArea, 1e-20f);
+
+  struct Cluster {
+    size_t begin;
+    size_t end;
+    float key;
+  };
+  std::vector<Cluster> sorted;
+  for (size_t i = 0; i + 1 < clusters.size(); ++i) {
+    glm::vec3 centroid(0.0f);
+    glm::vec3 normal(0.0f);
+    float area = 0.0f;
+    for (size_t t = clusters[i]; t < clusters[i + 1]; ++t) {
+      glm::vec3 a = corner(t, 0), b = corner(t, 1), c = corner(t, 2);
+      glm::vec3 cross = glm::cross(b - a, c - a);
+      float triangleArea = glm::length(cross);
+      centroid += (a + b + c) * (triangleArea / 3.0f);
+      normal += cross;
+      area += triangleArea;
+    }
+    centroid /= std::max(area, 1e-20f);
+    float length = glm::length(normal);
+    normal = length > 0.0f ? normal / length : glm::vec3(0.0f);
+    // clusters facing away from the center are likely in front of others
+    sorted.push_back(Cluster{clusters[i], clusters[i + 1],
+                             glm::dot(centroid - meshCentroid, normal)});
+  }
+  std::stable_sort(sorted.begin(), sorted.end(),
+                   [](const Cluster& a, const Cluster& b) {
+                     return a.key > b.key;
+                   });
+
+  std::vector<uint32_t> result;
+  result.reserve(triangleCount * 3);
+  for (const Cluster& cluster : sorted) {
+    result.insert(result.end(), indices.begin() + cluster.begin * 3,
+                  indices.begin() + cluster.end * 3);
+  }
+  std::copy(result.begin(), result.end(), indices.begin());
+}
+
+auto MeshOptimize::OptimizeVertexFetch(std::span<uint32_t> indices,
+                                       std::span<pdx::Vertex> vertices)
+    -> size_t {
+  std::vector<uint32_t> remap(vertices.size(), UINT32_MAX);
+  uint32_t next = 0;
+  for (uint32_t& index : indices) {
+    if (remap[index] == UINT32_MAX) {
+      remap[index] = next++;
+    }
+    index = remap[index];
+  }
+  size_t referenced = next;
+  for (uint32_t& slot : remap) {
+    if (slot == UINT32_MAX) {
+      slot = next++;
+    }
+  }
+
+  std::vector<Vertex> original(vertices.begin(), vertices.end());
+  for (size_t i = 0; i < original.size(); ++i) {
+    vertices[remap[i]] = original[i];
+  }
+  return referenced;
+}
+
+// coarser levels are simplified from the previous one down to this fraction
+// of its indices, and dropped if they end up above LOD_MIN_REDUCTION
+constexpr float LOD_REDUCTION = 0.5f;
+constexpr float LOD_MIN_REDUCTION = 0.85f;
+constexpr size_t LOD_MIN_TRIANGLES = 8;
+// largest error per level, relative to the packet's bounding box diagonal
+constexpr float LOD_MAX_ERROR = 0.05f;
+// smallest cosine between a triangle normal before and after a collapse,
+// also keeps collapses from leaving slivers behind
+constexpr float FLIP_THRESHOLD = 0.25f;
+
+// Garland and Heckbert error quadric, the area weighted sum of squared
+// distances to the planes of the triangles around a vertex
+struct Quadric {
+  double a00 = 0.0, a01 = 0.0, a02 = 0.0, a11 = 0.0, a12 = 0.0, a22 = 0.0;
+  double b0 = 0.0, b1 = 0.0, b2 = 0.0;
+  double c = 0.0;
+  double weight = 0.0;
+
+  // plane dot(n, p) + d = 0 with a unit normal n
+  static auto Plane(const glm::vec3& n, float d, float weight) -> Quadric {
+    Quadric q;
+    q.a00 = weight * n.x * n.x;
+    q.a01 = weight * n.x * n.y;
+    q.a02 = weight * n.x * n.z;
+    q.a11 = weight * n.y * n.y;
+    q.a12 = weight * n.y * n.z;
+    q.a22 = weight * n.z * n.z;
+    q.b0 = weight * n.x * d;
+    q.b1 = weight * n.y * d;
+    q.b2 = weight * n.z * d;
+    q.c = weight * d * d;
+    q.weight = weight;
+    return q;
+  }
+
+  auto operator+=(const Quadric& other) -> Quadric& {
+    a00 += other.a00;
+    a01 += other.a01;
+    a02 += other.a02;
+    a11 += other.a11;
+    a12 += other.a12;
+    a22 += other.a22;
+    b0 += other.b0;
+    b1 += other.b1;
+    b2 += other.b2;
+    c += other.c;
+    weight += other.weight;
+    return *this;
+  }
+
+  // mean squared distance of p to the planes
+  auto Error(const glm::vec3& p) const -> double {
+    double x = p.x, y = p.y, z = p.z;
+    double error = a00 * x * x + a11 * y * y + a22 * z * z +
+                   2.0 * (a01 * x * y + a02 * x * z + a12 * y * z) +
+                   2.0 * (b0 * x + b1 * y + b2 * z) + c;
+    return weight > 0.0 ? std::max(error, 0.0) / weight : 0.0;
+  }
+};
+
+auto MeshOptimize::Simplify(std::span<uint32_t> indices,
+                            std::span<const pdx::Vertex> vertices,
+                            size_t targetIndexCount, float targetError,
+                            float& error) -> size_t {
+  error = 0.0f;
+  size_t indexCount = indices.size() - indices.size() % 3;
+  const size_t vertexCount = vertices.size();
+  if (indexCount <= targetIndexCount || vertexCount == 0) {
+    return indexCount;
+  }
+
+  // vertices at the same position, split by an attribute seam, share the
+  // canonical vertex. Topology is tracked on canonical vertices only
+  std::vector<uint32_t> canonical(vertexCount);
+  {
+    std::vector<uint32_t> order(vertexCount);
+    std::iota(order.begin(), order.end(), 0);
+    std::sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+      const glm::vec3& pa = vertices[a].position;
+      const glm::vec3& pb = vertices[b].position;
+      return std::tie(pa.x, pa.y, pa.z) < std::tie(pb.x, pb.y, pb.z);
+    });
+    for (size_t i = 0; i < order.size(); ++i) {
+      bool same = i > 0 && vertices[order[i]].position ==
+                               vertices[order[i - 1]].position;
+      canonical[order[i]] = same ? canonical[order[i - 1]] : order[i];
+    }
+  }
+
+  // seams, open borders and non manifold edges keep their vertices
+  std::vector<uint8_t> locked(vertexCount, 0);
+  for (size_t v = 0; v < vertexCount; ++v) {
+    if (canonical[v] != v) {
+      locked[v] = 1;
+      locked[canonical[v]] = 1;
+    }
+  }
+  {
+    std::vector<std::pair<uint32_t, uint32_t>> edges;
+    for (size_t i = 0; i < indexCount; i += 3) {
+      for (int k = 0; k < 3; ++k) {
+        uint32_t a = canonical[indices[i + k]];
+        uint32_t b = canonical[indices[i + (k + 1) % 3]];
+        if (a != b) {
+          edges.emplace_back(std::min(a, b), std::max(a, b));
+        }
+      }
+    }
+    std::sort(edges.begin(), edges.end());
+    for (size_t i = 0; i < edges.size();) {
+      size_t end = i;
+      while (end < edges.size() && edges[end] == edges[i]) {
+        ++end;
+      }
+      if (end - i != 2) {
+        locked[edges[i].first] = 1;
+        locked[edges[i].second] = 1;
+      }
+      i = end;
+    }
+  }
+
+  std::vector<Quadric> quadrics(vertexCount);
+  for (size_t i = 0; i < indexCount; i += 3) {
+    const glm::vec3& p0 = vertices[indices[i]].position;
+    glm::vec3 n = glm::cross(vertices[indices[i + 1]].position - p0,
+                             vertices[indices[i + 2]].position - p0);
+    float length = glm::length(n);
+    if (length == 0.0f) {
+      continue;
+    }
+    n /= length;
+    Quadric plane = Quadric::Plane(n, -glm::dot(n, p0), 0.5f * length);
+    for (int k = 0; k < 3; ++k) {
+      quadrics[indices[i + k]] += plane;
+    }
+  }
+
+  struct Collapse {
+    uint32_t from;
+    uint32_t to;
+    double cost;
+  };
+  std::vector<Collapse> collapses;
+  std::vector<uint32_t> offsets(vertexCount + 1);
+  std::vector<uint32_t> adjacency;
+  std::vector<uint32_t> remap(vertexCount);
+  std::vector<uint8_t> touched(vertexCount);
+  std::vector<uint32_t> fromRing;
+  std::vector<uint32_t> toRing;
+  const double maxCost = (double)targetError * targetError;
+  double worst = 0.0;
+
+  // canonical vertices around v in its triangles, without skip
+  auto ring = [&](uint32_t v, uint32_t skip, std::vector<uint32_t>& out) {
+    out.clear();
+    for (uint32_t a = offsets[v]; a < offsets[v + 1]; ++a) {
+      for (int k = 0; k < 3; ++k) {
+        uint32_t other = canonical[indices[adjacency[a] * 3 + k]];
+        if (other != v && other != skip) {
+          out.push_back(other);
+        }
+      }
+    }
+    std::sort(out.begin(), out.end());
+    out.erase(std::unique(out.begin(), out.end()), out.end());
+  };
+
+  // rejects collapses that flip a triangle or make an edge non manifold
+  auto allowed = [&](uint32_t from, uint32_t to) {
+    const glm::vec3& target = vertices[to].position;
+    uint32_t edgeTriangles = 0;
+    for (uint32_t a = offsets[from]; a < offsets[from + 1]; ++a) {
+      const uint32_t *triangle = &indices[adjacency[a] * 3];
+      int corner = -1;
+      bool shared = false;
+      for (int k = 0; k < 3; ++k) {
+        corner = triangle[k] == from ? k : corner;
+        shared |= canonical[triangle[k]] == canonical[to];
+      }
+      if (shared) {
+        ++edgeTriangles;
+        continue;
+      }
+      const glm::vec3& p1 = vertices[triangle[(corner + 1) % 3]].position;
+      const glm::vec3& p2 = vertices[triangle[(corner + 2) % 3]].position;
+      glm::vec3 before = glm::cross(p1 - vertices[from].position,
+                                    p2 - vertices[from].position);
+      glm::vec3 after = glm::cross(p1 - target, p2 - target);
+      if (glm::dot(before, after) <=
+          FLIP_THRESHOLD * glm::length(before) * glm::length(after)) {
+        return false;
+      }
+    }
+    ring(from, canonical[to], fromRing);
+    ring(canonical[to], from, toRing);
+    size_t common = 0;
+    for (size_t i = 0, j = 0; i < fromRing.size() && j < toRing.size();) {
+      if (fromRing[i] == toRing[j]) {
+        ++common;
+        ++i;
+        ++j;
+      } else if (fromRing[i] < toRing[j]) {
+        ++i;
+      } else {
+        ++j;
+      }
+    }
+    return common <= edgeTriangles;
+  };
+
+  while (indexCount > targetIndexCount) {
+    // triangles around each canonical vertex
+    std::fill(offsets.begin(), offsets.end(), 0);
+    for (size_t i = 0; i < indexCount; ++i) {
+      ++offsets[canonical[indices[i]] + 1];
+    }
+    std::partial_sum(offsets.begin(), offsets.end(), offsets.begin());
+    adjacency.resize(indexCount);
+    {
+      std::vector<uint32_t> fill(offsets.begin(), offsets.end() - 1);
+      for (size_t i = 0; i < indexCount; ++i) {
+        adjacency[fill[canonical[indices[i]]]++] = (uint32_t)(i / 3);
+      }
+    }
+
+    collapses.clear();
+    for (size_t i = 0; i < indexCount; i += 3) {
+      for (int k = 0; k < 3; ++k) {
+        uint32_t a = indices[i + k];
+        uint32_t b = indices[i + (k + 1) % 3];
+        for (auto [from, to] : {std::pair(a, b), std::pair(b, a)}) {
+          if (!locked[from]) {
+            Quadric quadric = quadrics[from];
+            quadric += quadrics[to];
+            collapses.push_back(
+                Collapse{from, to, quadric.Error(vertices[to].position)});
+          }
+        }
+      }
+    }
+    std::sort(collapses.begin(), collapses.end(),
+              [](const Collapse& a, const Collapse& b) {
+                return a.cost < b.cost;
+              });
+
+    // a collapse removes two triangles on closed surfaces, and everything
+    // around it is left alone until the next pass
+    const size_t budget = (indexCount - targetIndexCount) / 6 + 1;
+    std::fill(touched.begin(), touched.end(), 0);
+    std::iota(remap.begin(), remap.end(), 0);
+    size_t applied = 0;
+    for (const Collapse& collapse : collapses) {
+      if (applied == budget || collapse.cost > maxCost) {
+        break;
+      }
+      if (touched[collapse.from] || touched[canonical[collapse.to]] ||
+          !allowed(collapse.from, collapse.to)) {
+        continue;
+      }
+      remap[collapse.from] = collapse.to;
+      quadrics[collapse.to] += quadrics[collapse.from];
+      worst = std::max(worst, collapse.cost);
+      for (uint32_t a = offsets[collapse.from];
+           a < offsets[collapse.from + 1]; ++a) {
+        for (int k = 0; k < 3; ++k) {
+          touched[canonical[indices[adjacency[a] * 3 + k]]] = 1;
+        }
+      }
+      ++applied;
+    }
+    if (applied == 0) {
+      break;
+    }
+
+    size_t write = 0;
+    for (size_t i = 0; i < indexCount; i += 3) {
+      uint32_t a = remap[indices[i]];
+      uint32_t b = remap[indices[i + 1]];
+      uint32_t c = remap[indices[i + 2]];
+      if (canonical[a] == canonical[b] || canonical[b] == canonical[c] ||
+          canonical[c] == canonical[a]) {
+        continue;
+      }
+      indices[write++] = a;
+      indices[write++] = b;
+      indices[write++] = c;
+    }
+    indexCount = write;
+  }
+
+  error = (float)std::sqrt(worst);
+  return indexCount;
+}
+
+auto MeshOptimize::BuildLods(pdx::MeshData& mesh) -> size_t {
+  if (!mesh.lods.empty()) {
+    return 0;
+  }
+  size_t built = 0;
+  for (MeshPacket& packet : mesh.packets) {
+    packet.firstLod = (uint32_t)mesh.lods.size();
+    packet.lodCount = 0;
+    if (packet.mode != MODE_TRIANGLES || packet.indexCount < 3) {
+      continue;
+    }
+    std::span<const uint32_t> source = PacketIndices(packet, mesh.indices);
+    PacketVertices range = VerticesOf(packet, source, mesh.vertices.size());
+    if (range.count == 0) {
+      continue;
+    }
+    std::vector<uint32_t> current(source.begin(), source.end());
+    std::span<const Vertex> vertices =
+        std::span(mesh.vertices).subspan(range.first, range.count);
+    const float maxError =
+        LOD_MAX_ERROR * glm::length(packet.boundsMax - packet.boundsMin);
+
+    // every level starts from the previous one, so the errors add up
+    float error = 0.0f;
+    while (packet.lodCount < MAX_LODS) {
+      size_t target = (size_t)(current.size() / 3 * LOD_REDUCTION) * 3;
+      if (target < LOD_MIN_TRIANGLES * 3) {
+        break;
+      }
+      float levelError = 0.0f;
+      size_t count =
+          Simplify(current, vertices, target, maxError, levelError);
+      if (count > current.size() * LOD_MIN_REDUCTION) {
+        break;
+      }
+      current.resize(count);
+      OptimizeVertexCache(current, vertices.size());
+      error += levelError;
+      mesh.lods.push_back(
+          MeshLod{(uint32_t)mesh.indices.size(), (uint32_t)count, error});
+      mesh.indices.insert(mesh.indices.end(), current.begin(), current.end());
+      ++packet.lodCount;
+      ++built;
+    }
+  }
+  return built;
+}
+
+auto MeshOptimize::Optimize(pdx::MeshData& mesh) -> Report {
+  Report report{Analyze(mesh.View()), {}, 0};
+
+  std::vector<PacketVertices> ranges;
+  for (const MeshPacket& packet : mesh.packets) {
+    ranges.push_back(packet.mode == MODE_TRIANGLES
+                         ? VerticesOf(packet, PacketIndices(packet,
+                                                            mesh.indices),
+                                      mesh.vertices.size())
+                         : PacketVertices{0, 0});
+  }
+
+  for (size_t p = 0; p < mesh.packets.size(); ++p) {
+    const MeshPacket& packet = mesh.packets[p];
+    if (packet.mode != MODE_TRIANGLES || packet.indexCount < 3 ||
+        ranges[p].count == 0) {
+      continue;
+    }
+    std::span<uint32_t> indices = std::span(mesh.indices).subspan(
+        packet.firstIndex, packet.indexCount - packet.indexCount % 3);
+    std::span<Vertex> vertices =
+        std::span(mesh.vertices).subspan(ranges[p].first, ranges[p].count);
+
+    OptimizeVertexCache(indices, vertices.size());
+    OptimizeOverdraw(indices, vertices);
+
+    // vertices shared with another packet have to stay where they are, and
+    // LOD index lists would need the same remap
+    bool shared = !mesh.lods.empty();
+    for (size_t other = 0; other < ranges.size() && !shared; ++other) {
+      shared = other != p && ranges[other].count > 0 &&
+               ranges[other].first < ranges[p].first + ranges[p].count &&
+               ranges[p].first < ranges[other].first + ranges[other].count;
+    }
+    if (!shared) {
+      OptimizeVertexFetch(indices, vertices);
+    }
+    ++report.packets;
+  }
+
+  report.after = Analyze(mesh.View());
+  return report;
+}
@@ -1,262 +1,301 @@
+#include "geometryarena.hpp"
+#include "glstate.hpp"
+#include "instancestream.hpp"
+#include "meshasset.hpp"
 #include "model.hpp"
+#include "samplercache.hpp"
+#include "texture.hpp"
+#include "texturecache.hpp"
 #include "types.hpp"
 
 #include <glad/gl.h>
 
 #include <glm/glm.hpp>
 
+#include <algorithm>
+#include <filesystem>
 #include <iostream>
-#include <optional>
 #include <string>
 
-#define TINYGLTF_IMPLEMENTATION
-#define STB_IMAGE_WRITE_IMPLEMENTATION
-#define TINYGLTF_NOEXCEPTION
-#define JSON_NOEXCEPTION
-#include <tiny_gltf.h>
-
 #define BUFFER_OFFSET(i) ((char *)NULL + (i))
 
 using namespace pdx;
 
-Model::Model(tinygltf::Model& model, std::map<std::string, pdx::vao_t> vaos,
-             std::map<int, GLuint> ebos, std::map<int, GLuint> textures)
-    : m_Model(model), m_Vaos(vaos), m_Ebos(ebos), m_Textures(textures) {}
+auto Model::FromGeometry(const pdx::MeshView& mesh) -> Model {
+  Model model;
+  pdx::GeometryArena& arena = pdx::GeometryArena::Get();
+  model.m_Geometry =
+      mesh.quantizedVertices.empty()
+          ? arena.Allocate(mesh.vertices, mesh.indices)
+          : arena.Allocate(mesh.quantizedVertices, mesh.indices,
+                           mesh.dequantization);
+  if (model.m_Geometry == nullptr) {
+    return model;
+  }
 
-static auto LoadModel(tinygltf::Model& model, const std::filesystem::path& path)
-    -> bool {
-  tinygltf::TinyGLTF loader;
-  std::string err;
-  std::string warn;
-  std::string file = path.string();
+  // packets index into the model's slice of the shared buffers
+  const uint32_t firstVertex = model.m_Geometry->firstVertex;
+  const uint32_t firstIndex = model.m_Geometry->firstIndex;
+  model.m_Packets.reserve(mesh.packets.size());
+  for (const auto& packet : mesh.packets) {
+    pdx::Bounds bounds{packet.boundsMin, packet.boundsMax};
+    glm::vec3 center = (packet.boundsMin + packet.boundsMax) * 0.5f;
+    float radius = glm::length(packet.boundsMax - center);
+
+    uint32_t firstLod = (uint32_t)model.m_Lods.size();
+    for (uint32_t i = 0; i < packet.lodCount; ++i) {
+      if (packet.firstLod + i >= mesh.lods.size()) {
+        break;
+      }
+      const pdx::MeshLod& lod = mesh.lods[packet.firstLod + i];
+      model.m_Lods.push_back(pdx::LodRange{
+          (GLsizei)lod.indexCount,
+          (firstIndex + lod.firstIndex) * sizeof(uint32_t), lod.error});
+    }
 
-  bool res = loader.LoadASCIIFromFile(&model, &err, &warn, file.c_str());
-  if (!warn.empty()) {
-    std::cout << "WARN: " << err << std::endl;
+    model.m_Packets.push_back(pdx::DrawPacket{
+        (GLenum)packet.mode, (GLsizei)packet.indexCount,
+        (firstIndex + packet.firstIndex) * sizeof(uint32_t),
+        (GLint)(firstVertex + packet.baseVertex), packet.material,
+        bounds, center, radius, firstLod,
+        (uint32_t)model.m_Lods.size() - firstLod});
   }
-
-  if (!err.empty()) {
-    std::cout << "ERR: " << err << std::endl;
+  for (const auto& node : mesh.nodes) {
+    model.m_Nodes.push_back(
+        pdx::NodeRange{node.name, node.firstPacket, node.packetCount});
   }
-
-  if (!res) {
-    std::cout << "Failed to load glTF: " << file << std::endl;
-  } else {
-    std::cout << "Loaded glTF: " << file << std::endl;
+  model.m_Textures.resize(mesh.textures.size());
+  for (const auto& texture : mesh.textures) {
+    model.m_Samplers.push_back(pdx::SamplerCache::Get().Acquire(texture));
   }
-
-  return res;
+  return model;
 }
 
-static auto BindMesh(std::map<int, GLuint>& vbos,
-                     std::map<int, GLuint>& textures, tinygltf::Model& model,
-                     tinygltf::Mesh& mesh) -> void {
-  for (size_t i = 0; i < model.bufferViews.size(); ++i) {
-    const tinygltf::BufferView& bufferView = model.bufferViews[i];
-    if (bufferView.target == 0) {
-      continue;
+auto Model::FromAsset(const pdx::MeshAsset& asset) -> Model {
+  pdx::MeshView mesh = asset.View();
+  Model model = FromGeometry(mesh);
+  for (size_t i = 0; i < mesh.textures.size(); ++i) {
+    std::shared_ptr<pdx::Texture> texture = asset.residentTextures[i];
+    if (texture == nullptr) {
+      texture = pdx::TextureCache::Get().Acquire(
+          asset.textureKeys[i], mesh.textures[i],
+          [](const pdx::MeshTexture& texture) {
+            return pdx::CreateTexture(texture, texture.pixels.data());
+          });
     }
-
-    const tinygltf::Buffer& buffer = model.buffers[bufferView.buffer];
-
-    GLuint vbo;
-    glGenBuffers(1, &vbo);
-    vbos[i] = vbo;
-    glBindBuffer(bufferView.target, vbo);
-
-    glBufferData(bufferView.target, bufferView.byteLength,
-                 &buffer.data.at(0) + bufferView.byteOffset, GL_STATIC_DRAW);
+    model.SetTexture(i, std::move(texture));
   }
+  return model;
+}
 
-  for (size_t i = 0; i < mesh.primitives.size(); ++i) {
-    tinygltf::Primitive primitive = mesh.primitives[i];
-    tinygltf::Accessor indexAccessor = model.accessors[primitive.indices];
-
-    for (auto& attrib : primitive.attributes) {
-      tinygltf::Accessor accessor = model.accessors[attrib.second];
-      int byteStride =
-          accessor.ByteStride(model.bufferViews[accessor.bufferView]);
-      glBindBuffer(GL_ARRAY_BUFFER, vbos[accessor.bufferView]);
+auto Model::SetTexture(size_t index, std::shared_ptr<pdx::Texture> texture)
+    -> void {
+  if (index < m_Textures.size()) {
+    m_Textures[index] = std::move(texture);
+  }
+}
 
-      int size = 1;
-      if (accessor.type != TINYGLTF_TYPE_SCALAR) {
-        size = accessor.type;
-      }
+auto Model::Draw() const -> void {
+  BindTextures();
+  DrawPackets(0, static_cast<uint32_t>(m_Packets.size()));
+}
 
-      int vaa = -1;
-      if (attrib.first.compare("POSITION") == 0) {
-        vaa = 0;
-      }
-      if (attrib.first.compare("NORMAL") == 0) {
-        vaa = 1;
-      }
-      if (attrib.first.compare("TANGENT") == 0) {
-        vaa = 2;
-      }
-      if (attrib.first.compare("TEXCOORD_0") == 0) {
-        vaa = 3;
-      }
-      if (attrib.first.compare("TEXCOORD_1") == 0) {
-        vaa = 4;
-      }
+auto Model::Draw(const std::string& name) const -> void {
+  DrawNode(NodeIndex(name));
+}
 
-      if (vaa > -1) {
-        glEnableVertexAttribArray(vaa);
-        glVertexAttribPointer(vaa, size, accessor.componentType,
-                              accessor.normalized ? GL_TRUE : GL_FALSE,
-                              byteStride, BUFFER_OFFSET(accessor.byteOffset));
-      } else {
-        std::cout << "vaa missing: " << attrib.first << std::endl;
-      }
+auto Model::NodeIndex(const std::string& name) const -> int {
+  for (size_t i = 0; i < m_Nodes.size(); ++i) {
+    if (m_Nodes[i].name == name) {
+      return static_cast<int>(i);
     }
+  }
+  return -1;
+}
 
-    if (model.textures.size() > 0) {
-      for (size_t texIdx = 0; texIdx < model.textures.size(); ++texIdx) {
-        tinygltf::Texture& tex = model.textures[texIdx];
-
-        if (tex.source > -1) {
-          GLuint texid;
-          glGenTextures(1, &texid);
-          textures[texIdx] = texid;
-
-          tinygltf::Image& image = model.images[tex.source];
-
-          glBindTexture(GL_TEXTURE_2D, texid);
-          glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
-          glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-          glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-          glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-          glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-
-          GLenum format = GL_RGBA;
-          if (image.component == 1) {
-            format = GL_RED;
-          } else if (image.component == 2) {
-            format = GL_RG;
-          } else if (image.component == 3) {
-            format = GL_RGB;
-          }
-
-          GLenum type = GL_UNSIGNED_BYTE;
-          if (image.bits == 16) {
-            type = GL_UNSIGNED_SHORT;
-          }
+auto Model::NodeBounds(int node) const -> std::optional<pdx::Bounds> {
+  std::span<const pdx::DrawPacket> packets = Packets(node);
+  if (packets.empty()) {
+    return {};
+  }
+  pdx::Bounds bounds = packets[0].bounds;
+  for (const pdx::DrawPacket& packet : packets) {
+    bounds.min = glm::min(bounds.min, packet.bounds.min);
+    bounds.max = glm::max(bounds.max, packet.bounds.max);
+  }
+  return bounds;
+}
 
-          glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, image.width, image.height, 0,
-                       format, type, &image.image.at(0));
-        }
-      }
-    }
+auto Model::DrawNode(int node) const -> void {
+  if (node < 0 || node >= m_Nodes.size()) {
+    return;
   }
+  BindTextures();
+  DrawPackets(m_Nodes[node].first, m_Nodes[node].count);
 }
 
-static auto BindModelNodes(std::map<int, GLuint>& vbos,
-                           std::map<int, GLuint>& textures,
-                           tinygltf::Model& model, tinygltf::Node& node)
+auto Model::DrawInstanced(std::span<const glm::mat4> transforms) const
     -> void {
-  if ((node.mesh >= 0) && (node.mesh < model.meshes.size())) {
-    BindMesh(vbos, textures, model, model.meshes[node.mesh]);
-  }
+  BindTextures();
+  DrawPacketsInstanced(0, static_cast<uint32_t>(m_Packets.size()),
+                       transforms);
+}
 
-  for (size_t i = 0; i < node.children.size(); ++i) {
-    assert((node.children[i] >= 0) && (node.children[i] < model.nodes.size()));
-    BindModelNodes(vbos, textures, model, model.nodes[node.children[i]]);
+auto Model::DrawNodeInstanced(int node,
+                              std::span<const glm::mat4> transforms) const
+    -> void {
+  if (node < 0 || node >= m_Nodes.size()) {
+    return;
   }
+  BindTextures();
+  DrawPacketsInstanced(m_Nodes[node].first, m_Nodes[node].count, transforms);
 }
 
-std::optional<Model> Model::FromGLTF(const std::filesystem::path& path) {
-  tinygltf::Model model;
-
-  if (!LoadModel(model, path)) {
+auto Model::Packets(int node) const -> std::span<const pdx::DrawPacket> {
+  if (node < 0) {
+    return m_Packets;
+  }
+  if (node >= m_Nodes.size()) {
     return {};
   }
+  return std::span(m_Packets).subspan(m_Nodes[node].first,
+                                      m_Nodes[node].count);
+}
 
-  std::map<std::string, pdx::vao_t> vaos;
-  std::map<int, GLuint> vbos, textures;
-
-  const tinygltf::Scene& scene = model.scenes[model.defaultScene];
-  for (size_t i = 0; i < scene.nodes.size(); ++i) {
-    assert((scene.nodes[i] >= 0) && (scene.nodes[i] < model.nodes.size()));
-    GLuint vao;
-    glGenVertexArrays(1, &vao);
-    glBindVertexArray(vao);
-    BindModelNodes(vbos, textures, model, model.nodes[scene.nodes[i]]);
-    glBindVertexArray(0);
-    // cleanup vbos but do not delete index buffers yet
-    for (auto it = vbos.cbegin(); it != vbos.cend();) {
-      tinygltf::BufferView bufferView = model.bufferViews[it->first];
-      if (bufferView.target != GL_ELEMENT_ARRAY_BUFFER) {
-        glDeleteBuffers(1, &vbos[it->first]);
-        vbos.erase(it++);
-      } else {
-        ++it;
-      }
-    }
-    vaos[model.nodes[scene.nodes[i]].name] = vao;
+auto Model::BindTextures() const -> void {
+  GLState& state = GLState::Get();
+  for (size_t i = 0; i < m_Textures.size(); ++i) {
+    state.BindTexture(i, GL_TEXTURE_2D,
+                      m_Textures[i] != nullptr ? m_Textures[i]->Id() : 0);
+    state.BindSampler(i, m_Samplers[i]);
   }
-  return std::make_optional(pdx::Model(model, vaos, vbos, textures));
 }
 
-auto Model::Draw() const -> void {
-  const tinygltf::Scene& scene = m_Model.scenes[m_Model.defaultScene];
-  for (size_t i = 0; i < scene.nodes.size(); ++i) {
-    glBindVertexArray(m_Vaos.at(m_Model.nodes[scene.nodes[i]].name));
-    for (size_t i = 0; i < m_Textures.size(); ++i) {
-      glActiveTexture(GL_TEXTURE0 + i);
-      glBindTexture(GL_TEXTURE_2D, m_Textures.at(i));
-    }
-    DrawNodes(m_Model.nodes[scene.nodes[i]]);
+auto Model::BindGeometry() const -> bool {
+  if (m_Geometry == nullptr) {
+    return false;
+  }
+  // consecutive models in the same page leave the VAO bound
+  pdx::GeometryArena::Get().Bind(*m_Geometry);
+  return true;
+}
 
-    for (size_t i = 0; i < m_Textures.size(); ++i) {
-      glActiveTexture(GL_TEXTURE0 + i);
-      glBindTexture(GL_TEXTURE_2D, 0);
+auto Model::Memory() const -> pdx::ModelMemory {
+  pdx::ModelMemory memory{sizeof(Model), 0, 0};
+  memory.cpu += m_Packets.capacity() * sizeof(pdx::DrawPacket) +
+                m_Lods.capacity() * sizeof(pdx::LodRange) +
+                m_Nodes.capacity() * sizeof(pdx::NodeRange) +
+                m_Textures.capacity() * sizeof(m_Textures[0]) +
+                m_Samplers.capacity() * sizeof(GLuint);
+  for (const pdx::NodeRange& node : m_Nodes) {
+    memory.cpu += node.name.capacity();
+  }
+  if (m_Geometry != nullptr) {
+    memory.geometry = pdx::GeometryArena::Bytes(*m_Geometry);
+  }
+  for (const auto& texture : m_Textures) {
+    if (texture != nullptr) {
+      memory.textures += texture->Bytes();
     }
-    glBindVertexArray(0);
   }
+  return memory;
 }
 
-auto Model::Draw(const std::string& name) const -> void {
-  const tinygltf::Scene& scene = m_Model.scenes[m_Model.defaultScene];
-  for (size_t i = 0; i < scene.nodes.size(); ++i) {
-    if (m_Model.nodes[scene.nodes[i]].name == name) {
-      glBindVertexArray(m_Vaos.at(m_Model.nodes[scene.nodes[i]].name));
-      for (size_t i = 0; i < m_Textures.size(); ++i) {
-        glActiveTexture(GL_TEXTURE0 + i);
-        glBindTexture(GL_TEXTURE_2D, m_Textures.at(i));
-      }
-
-      DrawNodes(m_Model.nodes[scene.nodes[i]]);
+auto Model::Textures() const
+    -> std::span<const std::shared_ptr<pdx::Texture>> {
+  return m_Textures;
+}
 
-      for (size_t i = 0; i < m_Textures.size(); ++i) {
-        glActiveTexture(GL_TEXTURE0 + i);
-        glBindTexture(GL_TEXTURE_2D, 0);
+auto Model::SelectLod(const pdx::DrawPacket& packet,
+                      const glm::mat4& transform,
+                      const pdx::LodView& view) const -> uint32_t {
+  if (packet.lodCount == 0) {
+    return 0;
+  }
+  uint32_t level = 0;
+  if (view.pixelScale > 0.0f) {
+    glm::mat4 modelView = view.view * transform;
+    float scale = 0.0f;
+    for (int i = 0; i < 3; ++i) {
+      scale = std::max(scale, glm::length(glm::vec3(modelView[i])));
+    }
+    glm::vec3 center(modelView * glm::vec4(packet.center, 1.0f));
+    float distance = glm::length(center) - packet.radius * scale;
+    if (distance > 0.0f) {
+      // pixels one model space unit covers at the closest point of the
+      // bounds, levels get coarser with every step
+      float pixels = view.pixelScale * scale / distance;
+      level = packet.lodCount;
+      while (level > 0 &&
+             m_Lods[packet.firstLod + level - 1].error * pixels >
+                 view.maxError) {
+        --level;
       }
-      glBindVertexArray(0);
-      break;
     }
   }
+  return std::min(level + view.bias, packet.lodCount);
 }
 
-auto Model::DrawNodes(const tinygltf::Node& node) const -> void {
-  if ((node.mesh >= 0) && (node.mesh < m_Model.meshes.size())) {
-    DrawMesh(m_Model.meshes[node.mesh]);
+auto Model::Lod(const pdx::DrawPacket& packet, uint32_t level) const
+    -> pdx::LodRange {
+  if (level == 0 || packet.lodCount == 0) {
+    return pdx::LodRange{packet.indexCount, packet.indexOffset, 0.0f};
   }
+  return m_Lods[packet.firstLod + std::min(level, packet.lodCount) - 1];
+}
 
-  const tinygltf::Scene& scene = m_Model.scenes[m_Model.defaultScene];
-  for (size_t i = 0; i < node.children.size(); ++i) {
-    DrawNodes(m_Model.nodes[node.children[i]]);
+auto Model::DrawLod(int node, const glm::mat4& transform,
+                    const pdx::LodView& view) const -> size_t {
+  std::span<const pdx::DrawPacket> packets = Packets(node);
+  if (packets.empty() || !BindGeometry()) {
+    return 0;
   }
+  BindTextures();
+  size_t indices = 0;
+  for (const pdx::DrawPacket& packet : packets) {
+    pdx::LodRange lod = Lod(packet, SelectLod(packet, transform, view));
+    glDrawElementsBaseVertex(packet.mode, lod.indexCount, GL_UNSIGNED_INT,
+                             BUFFER_OFFSET(lod.indexOffset),
+                             packet.baseVertex);
+    indices += lod.indexCount;
+  }
+  return indices;
 }
 
-auto Model::DrawMesh(const tinygltf::Mesh& mesh) const -> void {
-  for (size_t i = 0; i < mesh.primitives.size(); ++i) {
-    tinygltf::Primitive primitive = mesh.primitives[i];
-    tinygltf::Accessor indexAccessor = m_Model.accessors[primitive.indices];
-
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_Ebos.at(indexAccessor.bufferView));
+auto Model::DrawPackets(uint32_t first, uint32_t count) const -> void {
+  if (!BindGeometry()) {
+    return;
+  }
+  for (uint32_t i = first; i < first + count; ++i) {
+    const pdx::DrawPacket& packet = m_Packets[i];
+    glDrawElementsBaseVertex(packet.mode, packet.indexCount, GL_UNSIGNED_INT,
+                             BUFFER_OFFSET(packet.indexOffset),
+                             packet.baseVertex);
+  }
+}
 
-    glDrawElements(primitive.mode, indexAccessor.count,
-                   indexAccessor.componentType,
-                   BUFFER_OFFSET(indexAccessor.byteOffset));
+auto Model::DrawPacketsInstanced(uint32_t first, uint32_t count,
+                                 std::span<const glm::mat4> transforms) const
+    -> void {
+  if (m_Geometry == nullptr) {
+    return;
+  }
+  pdx::InstanceStream& stream = pdx::InstanceStream::Get();
+  // the draw id attribute advances per instance as well, so never draw more
+  // instances than the id buffer holds
+  const size_t batch = pdx::GeometryArena::MAX_DRAW_IDS;
+  for (size_t start = 0; start < transforms.size(); start += batch) {
+    std::span<const glm::mat4> instances =
+        transforms.subspan(start, std::min(batch, transforms.size() - start));
+    GLintptr offset = stream.Push(instances);
+    pdx::GeometryArena::Get().BindInstances(*m_Geometry, stream.Buffer(),
+                                            offset);
+    for (uint32_t i = first; i < first + count; ++i) {
+      const pdx::DrawPacket& packet = m_Packets[i];
+      glDrawElementsInstancedBaseVertex(
+          packet.mode, packet.indexCount, GL_UNSIGNED_INT,
+          BUFFER_OFFSET(packet.indexOffset), (GLsizei)instances.size(),
+          packet.baseVertex);
+    }
   }
 }
@@ -1,45 +1,81 @@
 #include "portal.hpp"
 #include "assetdir.hpp"
+#include "assetloader.hpp"
+#include "drawlist.hpp"
 #include "model.hpp"
 
 #include <glm/ext/matrix_transform.hpp>
 #include <glm/gtc/matrix_access.hpp>
 #include <glm/gtc/quaternion.hpp>
 
+#include <limits>
+#include <vector>
+
 using namespace pdx;
 
 static AssetDir portalDir{"data", "models", "portal"};
-static std::optional<pdx::Model> portal = {};
 
-Portal::Portal(const pdx::Camera& viewpoint) : m_Viewpoint(viewpoint) {
-  if (!portal.has_value()) {
-    portal = pdx::Model::FromGLTF(portalDir.GetFile("scene.gltf"));
-  }
+Portal::Portal(const pdx::Camera& viewpoint, pdx::AssetLoader& assets)
+    : m_Viewpoint(viewpoint), m_Assets(&assets) {
+  // every portal shares the same model, the loader only loads it once
+  m_Model = assets.Load(portalDir.GetFile("scene.gltf"));
   m_Orientation = glm::fquat(1.0f, 0.0f, 0.0f, 0.0f);
-  m_ModelMatrix = glm::mat4(1.0);
-  m_ModelMatrix = glm::translate(m_ModelMatrix, m_Viewpoint.Position()) *
+  UpdateTransforms();
+}
+
+auto Portal::UpdateTransforms() -> void {
+  glm::vec3 position = Position();
+  m_ModelMatrix = glm::translate(glm::mat4(1.0f), position) *
                   glm::mat4_cast(m_Orientation);
+  // rigid, undone by the opposite rotation after the opposite translation
+  m_InverseModelMatrix = glm::mat4_cast(glm::conjugate(m_Orientation)) *
+                         glm::translate(glm::mat4(1.0f), -position);
+  glm::vec3 normal = m_Orientation * glm::vec3(0.0f, 0.0f, -1.0f);
+  m_Plane = glm::vec4(normal, -glm::dot(normal, position));
+  m_ClipPlane = glm::vec4(normal, glm::length(position));
+  ++m_Revision;
+}
+
+auto Portal::GetModel() const -> const pdx::Model * {
+  const pdx::Model *model = m_Assets->Get(m_Model);
+  if (model != nullptr && m_FrameNode < 0) {
+    m_FrameNode = model->NodeIndex("Frame");
+    m_PlaneNode = model->NodeIndex("Portal");
+  }
+  return model;
 }
 
-auto Portal::DrawPortalFrame(const glm::mat4& view, const glm::mat4& proj,
-                             const pdx::Shader& shader) const -> void {
-  if (portal.has_value()) {
+auto Portal::AddPortalFrame(pdx::DrawList& list) const -> void {
+  if (const pdx::Model *model = GetModel()) {
+    list.Add(*model, m_ModelMatrix, m_FrameNode);
+  }
+}
+
+auto Portal::DrawPortalPlane(const pdx::Shader& shader) const -> void {
+  if (const pdx::Model *model = GetModel()) {
     shader.Use();
     shader.SetMat4fv("model", m_ModelMatrix);
-    shader.SetMat4fv("view", view);
-    shader.SetMat4fv("projection", proj);
-    portal->Draw("Frame");
+    model->DrawNode(m_PlaneNode);
   }
 }
 
-auto Portal::DrawPortalPlane(const glm::mat4& view, const glm::mat4& proj,
-                             const pdx::Shader& shader) const -> void {
-  if (portal.has_value()) {
+auto Portal::DrawPortalPlanes(std::span<const pdx::Portal> portals,
+                              const pdx::Shader& shader) -> void {
+  // every portal shares one model, see the constructor
+  const pdx::Model *model = nullptr;
+  int node = -1;
+  std::vector<glm::mat4> transforms;
+  transforms.reserve(portals.size());
+  for (const auto& portal : portals) {
+    if (const pdx::Model *portalModel = portal.GetModel()) {
+      model = portalModel;
+      node = portal.m_PlaneNode;
+      transforms.push_back(portal.m_ModelMatrix);
+    }
+  }
+  if (model != nullptr) {
     shader.Use();
-    shader.SetMat4fv("model", m_ModelMatrix);
-    shader.SetMat4fv("view", view);
-    shader.SetMat4fv("projection", proj);
-    portal->Draw("Portal");
+    model->DrawNodeInstanced(node, transforms);
   }
 }
 
@@ -47,23 +83,51 @@ auto Portal::Position() const -> glm::vec3 { return m_Viewpoint.Position(); }
 auto Portal::Front() const -> glm::vec3 { return m_Viewpoint.Front(); }
 auto Portal::Right() const -> glm::vec3 { return m_Viewpoint.Right(); }
 auto Portal::ModelMatrix() const -> glm::mat4 { return m_ModelMatrix; }
+auto Portal::InverseModelMatrix() const -> const glm::mat4& {
+  return m_InverseModelMatrix;
+}
+
+auto Portal::PairTransform() const -> const glm::mat4& {
+  // the destination cannot tell this portal that it turned, so its revision
+  // is checked here
+  if (m_PairRevision != m_Revision ||
+      m_PairDestinationRevision != m_Destination->m_Revision) {
+    m_PairTransform = m_ModelMatrix *
+                      glm::rotate(glm::mat4(1.0f), glm::radians(180.0f),
+                                  glm::vec3(0.0f, 1.0f, 0.0f) *
+                                      m_Destination->Orientation()) *
+                      m_Destination->m_InverseModelMatrix;
+    m_PairRevision = m_Revision;
+    m_PairDestinationRevision = m_Destination->m_Revision;
+  }
+  return m_PairTransform;
+}
 auto Portal::ViewMatrix() const -> glm::mat4 {
   return m_Viewpoint.GetViewMatrix();
 }
 
+auto Portal::Plane() const -> glm::vec4 { return m_Plane; }
+
 auto Portal::ClippedProj(const glm::mat4& view, const glm::mat4& proj) const
     -> glm::mat4 {
-  float d = glm::length(Position());
-  // Calculate the clip plane with a normal and distance to the origin
-  glm::vec4 newClipPlane(m_Orientation * glm::vec3(0.0f, 0.0f, -1.0f), d);
-  newClipPlane = glm::inverse(glm::transpose(view)) * newClipPlane;
+  // view is rigid, so its inverse transpose moves the plane with the same
+  // rotation and a translation along the rotated normal
+  glm::vec3 normal = glm::mat3(view) * glm::vec3(m_ClipPlane);
+  glm::vec4 newClipPlane(normal, m_ClipPlane.w -
+                                     glm::dot(normal, glm::vec3(view[3])));
   // If the new clip plane's fourth component (w) is greater than 0, indicating
   // that it is facing away from the camera,
   if (newClipPlane.w > 0.0f)
     return proj;
-  glm::vec4 q =
-      glm::inverse(proj) * glm::vec4(glm::sign(newClipPlane.x),
-                                     glm::sign(newClipPlane.y), 1.0f, 1.0f);
+  // q = inverse(proj) * (sign x, sign y, 1, 1). Only the third row of proj
+  // differs from a perspective projection, whose last row is (0, 0, -1, 0),
+  // so the system solves row by row
+  glm::vec4 q;
+  q.x = (glm::sign(newClipPlane.x) + proj[2][0]) / proj[0][0];
+  q.y = (glm::sign(newClipPlane.y) + proj[2][1]) / proj[1][1];
+  q.z = -1.0f;
+  q.w = (1.0f - proj[0][2] * q.x - proj[1][2] * q.y + proj[2][2]) /
+        proj[3][2];
   glm::vec4 c = newClipPlane * (2.0f / (glm::dot(newClipPlane, q)));
   glm::mat4 newProjMat = proj;
   // third row = new clip plane - fourth row of projection matrix
@@ -71,8 +135,62 @@ auto Portal::ClippedProj(const glm::mat4& view, const glm::mat4& proj) const
   return newProjMat;
 }
 
+auto Portal::ScreenRect(const glm::mat4& viewProj,
+                        const glm::vec4& parent) const
+    -> std::optional<glm::vec4> {
+  const pdx::Model *model = GetModel();
+  if (model == nullptr) {
+    return {};
+  }
+  std::optional<pdx::Bounds> bounds = model->NodeBounds(m_PlaneNode);
+  if (!bounds.has_value()) {
+    return {};
+  }
+
+  glm::mat4 transform = viewProj * m_ModelMatrix;
+  // one bit per clip plane, set while every corner is outside of it
+  uint32_t outside = 0x3F;
+  bool behind = false;
+  glm::vec4 rect(std::numeric_limits<float>::max(),
+                 std::numeric_limits<float>::max(),
+                 std::numeric_limits<float>::lowest(),
+                 std::numeric_limits<float>::lowest());
+  for (int i = 0; i < 8; ++i) {
+    glm::vec3 corner(i & 1 ? bounds->max.x : bounds->min.x,
+                     i & 2 ? bounds->max.y : bounds->min.y,
+                     i & 4 ? bounds->max.z : bounds->min.z);
+    glm::vec4 clip = transform * glm::vec4(corner, 1.0f);
+    outside &= (clip.x < -clip.w ? 1u : 0u) | (clip.x > clip.w ? 2u : 0u) |
+               (clip.y < -clip.w ? 4u : 0u) | (clip.y > clip.w ? 8u : 0u) |
+               (clip.z < -clip.w ? 16u : 0u) | (clip.z > clip.w ? 32u : 0u);
+    if (clip.w <= 0.0f) {
+      behind = true;
+      continue;
+    }
+    rect.x = std::min(rect.x, clip.x / clip.w);
+    rect.y = std::min(rect.y, clip.y / clip.w);
+    rect.z = std::max(rect.z, clip.x / clip.w);
+    rect.w = std::max(rect.w, clip.y / clip.w);
+  }
+  if (outside != 0) {
+    return {};
+  }
+  if (behind) {
+    // corners behind the eye do not project to anything meaningful, keep
+    // the whole parent
+    rect = parent;
+  }
+  rect = glm::vec4(std::max(rect.x, parent.x), std::max(rect.y, parent.y),
+                   std::min(rect.z, parent.z), std::min(rect.w, parent.w));
+  if (rect.x >= rect.z || rect.y >= rect.w) {
+    return {};
+  }
+  return rect;
+}
+
 auto Portal::SetDestination(pdx::Portal *portal) -> void {
   m_Destination = portal;
+  m_PairRevision = UINT32_MAX;
 }
 
 auto Portal::GetDestination() const -> pdx::Portal * { return m_Destination; }
@@ -80,6 +198,5 @@ auto Portal::Orientation() const -> glm::fquat { return m_Orientation; }
 
 auto Portal::AddAngle(float angle, const glm::vec3& axis) -> void {
   m_Orientation *= glm::angleAxis(glm::radians(angle), axis);
-  m_ModelMatrix = glm::translate(glm::mat4(1.0f), Position()) *
-                  glm::mat4_cast(m_Orientation);
+  UpdateTransforms();
 }
@@ -0,0 +1,165 @@
+#include "portalbudget.hpp"
+
+#include <algorithm>
+
+using namespace pdx;
+
+// shallowest depth the controller goes down to, one portal seen through
+// another still works
+constexpr uint32_t MIN_PORTAL_DEPTH = 1;
+constexpr float MIN_VIEW_BUDGET = 2.0f;
+constexpr float MAX_VIEW_BUDGET = 256.0f;
+// weight of a new sample in the smoothed timings
+constexpr float SMOOTHING = 0.1f;
+// measured frames between changes, so the smoothed timings catch up first
+constexpr uint32_t COOLDOWN = 20;
+// a level is only added if the frame stays this far below the target
+constexpr float HEADROOM = 0.85f;
+
+auto PortalBudget::Create(float targetMs, uint32_t depth, bool adaptive)
+    -> void {
+  m_TargetMs = targetMs;
+  m_Depth = std::min(depth, MAX_PORTAL_DEPTH);
+  m_Adaptive = adaptive;
+  m_ViewBudget = UINT32_MAX;
+  m_Cooldown = 0;
+  m_Measured = false;
+}
+
+auto PortalBudget::Destroy() -> void {
+  for (Frame& frame : m_Frames) {
+    if (!frame.queries.empty()) {
+      glDeleteQueries((GLsizei)frame.queries.size(), frame.queries.data());
+    }
+    frame = Frame{};
+  }
+}
+
+auto PortalBudget::BeginFrame() -> void {
+  m_LastRecursed = m_Frames[m_Current].recursed;
+  m_Current = (m_Current + 1) % LATENCY;
+  Frame& frame = m_Frames[m_Current];
+  // issued LATENCY frames ago
+  if (frame.used > 0 && Read(frame) && m_Adaptive) {
+    Adjust();
+  }
+  frame.used = 0;
+  frame.views.fill(0);
+  frame.views[0] = 1;
+  frame.recursed = 0;
+  Mark(NO_LEVEL);
+}
+
+auto PortalBudget::Mark(uint32_t level) -> void {
+  Frame& frame = m_Frames[m_Current];
+  if (frame.used == frame.queries.size()) {
+    GLuint query;
+    glGenQueries(1, &query);
+    frame.queries.push_back(query);
+    frame.levels.push_back(NO_LEVEL);
+  }
+  glQueryCounter(frame.queries[frame.used], GL_TIMESTAMP);
+  frame.levels[frame.used++] = level;
+}
+
+auto PortalBudget::EndFrame() -> void { Mark(NO_LEVEL); }
+
+auto PortalBudget::Recurse(uint32_t level) -> bool {
+  Frame& frame = m_Frames[m_Current];
+  if (level + 1 < PORTAL_LEVELS) {
+    ++frame.views[level + 1];
+  }
+  if (level >= m_Depth || frame.recursed >= m_ViewBudget) {
+    return false;
+  }
+  ++frame.recursed;
+  return true;
+}
+
+auto PortalBudget::SetTarget(float targetMs) -> void { m_TargetMs = targetMs; }
+
+auto PortalBudget::Adaptive() const -> bool { return m_Adaptive; }
+
+auto PortalBudget::Stats() const -> PortalBudgetStats {
+  return PortalBudgetStats{m_Depth,    m_ViewBudget, m_LastRecursed,
+                           m_FrameMs,  m_TargetMs,   m_LevelMs,
+                           m_LevelViews};
+}
+
+auto PortalBudget::Read(Frame& frame) -> bool {
+  // the GPU is further behind than LATENCY frames, dropping the sample is
+  // cheaper than waiting for it
+  GLuint available = GL_FALSE;
+  glGetQueryObjectuiv(frame.queries[frame.used - 1],
+                      GL_QUERY_RESULT_AVAILABLE, &available);
+  if (available == GL_FALSE) {
+    return false;
+  }
+
+  std::array<float, PORTAL_LEVELS> levelMs{};
+  GLuint64 first = 0;
+  GLuint64 previous = 0;
+  for (uint32_t i = 0; i < frame.used; ++i) {
+    GLuint64 time = 0;
+    glGetQueryObjectui64v(frame.queries[i], GL_QUERY_RESULT, &time);
+    if (i == 0) {
+      first = time;
+    } else if (frame.levels[i - 1] < PORTAL_LEVELS) {
+      levelMs[frame.levels[i - 1]] += (float)(time - previous) * 1e-6f;
+    }
+    previous = time;
+  }
+  float frameMs = (float)(previous - first) * 1e-6f;
+
+  auto smooth = [this](float& value, float sample) {
+    value = m_Measured ? value + (sample - value) * SMOOTHING : sample;
+  };
+  smooth(m_FrameMs, frameMs);
+  smooth(m_RecursedViews, (float)frame.recursed);
+  for (uint32_t level = 0; level < PORTAL_LEVELS; ++level) {
+    smooth(m_LevelMs[level], levelMs[level]);
+    smooth(m_LevelViews[level], (float)frame.views[level]);
+  }
+  m_Measured = true;
+  return true;
+}
+
+auto PortalBudget::Adjust() -> void {
+  if (m_Cooldown > 0) {
+    --m_Cooldown;
+    return;
+  }
+
+  // views at the terminal level draw the scene but no portals behind it
+  uint32_t terminal = m_Depth + 1;
+  if (m_FrameMs > m_TargetMs && m_Depth > MIN_PORTAL_DEPTH) {
+    --m_Depth;
+    m_Cooldown = COOLDOWN;
+    return;
+  }
+  if (m_FrameMs < m_TargetMs && m_Depth < MAX_PORTAL_DEPTH &&
+      m_LastRecursed < m_ViewBudget && m_LevelViews[terminal] > 0.0f) {
+    // every portal visible at the terminal level becomes at least one view
+    // one level further down
+    float growth =
+        std::max(1.0f, m_LevelViews[terminal] / m_LevelViews[m_Depth]);
+    if (m_FrameMs + m_LevelMs[terminal] * growth < m_TargetMs * HEADROOM) {
+      ++m_Depth;
+      m_Cooldown = COOLDOWN;
+      return;
+    }
+  }
+
+  // a recursing view pays for itself and every view behind it, the budget
+  // keeps as many of them as fit into the target
+  float portalMs = 0.0f;
+  for (uint32_t level = 1; level < PORTAL_LEVELS; ++level) {
+    portalMs += m_LevelMs[level];
+  }
+  if (m_RecursedViews >= 1.0f && portalMs > 0.0f) {
+    float viewMs = portalMs / m_RecursedViews;
+    float views = m_RecursedViews + (m_TargetMs - m_FrameMs) / viewMs;
+    m_ViewBudget =
+        (uint32_t)std::clamp(views, MIN_VIEW_BUDGET, MAX_VIEW_BUDGET);
+  }
+}
@@ -0,0 +1,133 @@
+#include "portaltargets.hpp"
+#include "glstate.hpp"
+
+#include <algorithm>
+#include <iostream>
+
+using namespace pdx;
+
+// redraws in a row caused only by other images, each one adds a level of
+// recursion to an image that stopped changing
+constexpr uint32_t MAX_GENERATION = 8;
+
+auto PortalTargets::Create(size_t count, GLsizei width, GLsizei height)
+    -> void {
+  Destroy();
+  GLState& state = GLState::Get();
+  m_Targets.resize(count);
+  for (Target& target : m_Targets) {
+    glGenRenderbuffers(1, &target.depth);
+    glBindRenderbuffer(GL_RENDERBUFFER, target.depth);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width,
+                          height);
+    glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+    glGenTextures(2, target.textures.data());
+    glGenFramebuffers(2, target.framebuffers.data());
+    for (size_t i = 0; i < 2; ++i) {
+      state.BindTexture(PORTAL_VIEW_UNIT, GL_TEXTURE_2D, target.textures[i]);
+      glTexStorage2D(GL_TEXTURE_2D, 1, GL_RGBA8, width, height);
+      // sampled with the sampler of PORTAL_VIEW_UNIT unbound
+      glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+      glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+      glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+      glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+      glBindFramebuffer(GL_FRAMEBUFFER, target.framebuffers[i]);
+      glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
+                             GL_TEXTURE_2D, target.textures[i], 0);
+      glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT,
+                                GL_RENDERBUFFER, target.depth);
+      if (glCheckFramebufferStatus(GL_FRAMEBUFFER) !=
+          GL_FRAMEBUFFER_COMPLETE) {
+        std::cout << "Portal framebuffer is incomplete" << std::endl;
+      }
+    }
+  }
+  glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+auto PortalTargets::Destroy() -> void {
+  GLState& state = GLState::Get();
+  for (Target& target : m_Targets) {
+    glDeleteFramebuffers(2, target.framebuffers.data());
+    for (GLuint texture : target.textures) {
+      state.DeleteTexture(texture);
+    }
+    glDeleteRenderbuffers(1, &target.depth);
+  }
+  m_Targets.clear();
+}
+
+auto PortalTargets::Size() const -> size_t { return m_Targets.size(); }
+
+auto PortalTargets::Begin(uint32_t portal, const glm::mat4& viewProj,
+                          const glm::mat4& surface,
+                          std::span<const uint32_t> sources,
+                          bool sceneChanged) -> bool {
+  Target& target = m_Targets[portal];
+  bool changed = !target.valid || sceneChanged ||
+                 target.viewProj != viewProj ||
+                 target.surfaces[target.current] != surface ||
+                 !std::equal(sources.begin(), sources.end(),
+                             target.sources.begin(), target.sources.end());
+  uint32_t generation = 0;
+  if (!changed) {
+    // images redrawn since this one was drawn show more than it does
+    bool stale = false;
+    for (uint32_t source : sources) {
+      const Target& other = m_Targets[source];
+      if (other.frame >= target.frame &&
+          other.generation + 1 < MAX_GENERATION) {
+        stale = true;
+        generation = std::max(generation, other.generation + 1);
+      }
+    }
+    if (!stale) {
+      ++m_Cached;
+      return false;
+    }
+  }
+
+  target.pending = true;
+  target.viewProj = viewProj;
+  target.surfaces[1 - target.current] = surface;
+  target.sources.assign(sources.begin(), sources.end());
+  target.frame = m_Frame;
+  target.generation = generation;
+  ++m_Drawn;
+
+  glBindFramebuffer(GL_FRAMEBUFFER, target.framebuffers[1 - target.current]);
+  glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+  return true;
+}
+
+auto PortalTargets::Present() -> void {
+  for (Target& target : m_Targets) {
+    if (target.pending) {
+      target.current = 1 - target.current;
+      target.valid = true;
+      target.pending = false;
+    }
+  }
+  glBindFramebuffer(GL_FRAMEBUFFER, 0);
+  ++m_Frame;
+  m_LastDrawn = m_Drawn;
+  m_LastCached = m_Cached;
+  m_Drawn = 0;
+  m_Cached = 0;
+}
+
+auto PortalTargets::Texture(uint32_t portal) const -> GLuint {
+  const Target& target = m_Targets[portal];
+  return target.valid ? target.textures[target.current] : 0;
+}
+
+auto PortalTargets::Surface(uint32_t portal) const -> const glm::mat4& {
+  const Target& target = m_Targets[portal];
+  return target.surfaces[target.current];
+}
+
+auto PortalTargets::Drawn() const -> uint32_t { return m_LastDrawn; }
+
+auto PortalTargets::Cached() const -> uint32_t { return m_LastCached; }
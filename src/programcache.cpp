@@ -0,0 +1,187 @@
+#include "programcache.hpp"
+
+#include <glad/gl.h>
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "assetdir.hpp"
+
+using namespace pdx;
+
+static const AssetDir CACHE_DIR{"shadercache"};
+
+constexpr uint32_t CACHE_MAGIC = 0x42584450; // "PDXB"
+constexpr uint32_t CACHE_VERSION = 1;
+
+struct CacheHeader {
+  uint32_t magic;
+  uint32_t version;
+  uint64_t driverHash;
+  uint64_t sourceHash;
+  uint64_t checksum;
+  uint32_t format;
+  uint32_t length;
+};
+
+// 64 bit FNV-1a
+static auto Hash(const void *data, size_t size,
+                 uint64_t hash = 14695981039346656037ull) -> uint64_t {
+  const auto *bytes = static_cast<const uint8_t *>(data);
+  for (size_t i = 0; i < size; ++i) {
+    hash ^= bytes[i];
+    hash *= 1099511628211ull;
+  }
+  return hash;
+}
+
+static auto HashString(const char *str, uint64_t hash) -> uint64_t {
+  if (str == nullptr) {
+    return hash;
+  }
+  // include the terminator so "ab" + "c" and "a" + "bc" differ
+  return Hash(str, strlen(str) + 1, hash);
+}
+
+auto ProgramCache::HashSources(std::string_view vertCode,
+                               std::string_view fragCode) -> uint64_t {
+  uint64_t hash = Hash(vertCode.data(), vertCode.size());
+  hash = Hash("", 1, hash);
+  return Hash(fragCode.data(), fragCode.size(), hash);
+}
+
+auto ProgramCache::Init() -> void {
+  m_Initialized = true;
+
+  int formats = 0;
+  glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+  if (formats == 0) {
+    std::cout << "Program binaries not supported by driver" << std::endl;
+    return;
+  }
+
+  uint64_t hash = 14695981039346656037ull;
+  hash = HashString((const char *)glGetString(GL_VENDOR), hash);
+  hash = HashString((const char *)glGetString(GL_RENDERER), hash);
+  hash = HashString((const char *)glGetString(GL_VERSION), hash);
+  m_DriverHash = hash;
+
+  m_Dir = CACHE_DIR.GetFile("");
+  std::error_code ec;
+  std::filesystem::create_directories(m_Dir, ec);
+  if (ec) {
+    std::cout << "Failed to create shader cache: " << m_Dir << std::endl;
+    return;
+  }
+  m_Supported = true;
+}
+
+auto ProgramCache::EntryPath(uint64_t sourceHash) const
+    -> std::filesystem::path {
+  char name[32];
+  snprintf(name, sizeof(name), "%016llx.bin", (unsigned long long)sourceHash);
+  return m_Dir / name;
+}
+
+auto ProgramCache::Load(uint64_t sourceHash, pdx::program_t program) -> bool {
+  if (!m_Initialized) {
+    Init();
+  }
+  if (!m_Supported) {
+    return false;
+  }
+
+  auto path = EntryPath(sourceHash);
+  std::ifstream file(path, std::ios::binary);
+  if (!file) {
+    ++m_Misses;
+    return false;
+  }
+
+  std::error_code ec;
+  uintmax_t fileSize = std::filesystem::file_size(path, ec);
+  CacheHeader header;
+  std::vector<char> binary;
+  bool valid = false;
+  // the length is checked against the file before anything is allocated
+  // for it, a truncated entry must not turn into a huge allocation
+  if (!ec && fileSize >= sizeof(header) &&
+      file.read((char *)&header, sizeof(header)) &&
+      header.magic == CACHE_MAGIC && header.version == CACHE_VERSION &&
+      header.driverHash == m_DriverHash && header.sourceHash == sourceHash &&
+      header.length == fileSize - sizeof(header)) {
+    binary.resize(header.length);
+    valid = file.read(binary.data(), binary.size()) &&
+            Hash(binary.data(), binary.size()) == header.checksum;
+  }
+  file.close();
+
+  if (valid) {
+    glProgramBinary(program, header.format, binary.data(), header.length);
+    int success;
+    glGetProgramiv(program, GL_LINK_STATUS, &success);
+    valid = success != 0;
+  }
+
+  if (!valid) {
+    // stale or corrupt, drop it so the next link can replace it
+    std::filesystem::remove(path, ec);
+    ++m_Misses;
+    return false;
+  }
+
+  ++m_Hits;
+  return true;
+}
+
+auto ProgramCache::Store(uint64_t sourceHash, pdx::program_t program)
+    -> void {
+  if (!m_Initialized) {
+    Init();
+  }
+  if (!m_Supported) {
+    return;
+  }
+
+  int length = 0;
+  glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+  if (length <= 0) {
+    return;
+  }
+
+  std::vector<char> binary(length);
+  GLenum format = 0;
+  glGetProgramBinary(program, length, &length, &format, binary.data());
+
+  CacheHeader header{CACHE_MAGIC,
+                     CACHE_VERSION,
+                     m_DriverHash,
+                     sourceHash,
+                     Hash(binary.data(), length),
+                     format,
+                     (uint32_t)length};
+
+  // write to a temporary first so a crash never leaves a truncated entry
+  auto path = EntryPath(sourceHash);
+  auto tmpPath = path;
+  tmpPath += ".tmp";
+  {
+    std::ofstream file(tmpPath, std::ios::binary | std::ios::trunc);
+    file.write((const char *)&header, sizeof(header));
+    file.write(binary.data(), length);
+    if (!file) {
+      std::cout << "Failed to write shader cache: " << tmpPath << std::endl;
+      return;
+    }
+  }
+  std::error_code ec;
+  std::filesystem::rename(tmpPath, path, ec);
+}
+
+auto ProgramCache::Hits() const -> uint32_t { return m_Hits; }
+
+auto ProgramCache::Misses() const -> uint32_t { return m_Misses; }
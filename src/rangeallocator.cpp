@@ -0,0 +1,69 @@
+#include "rangeallocator.hpp"
+
+#include <cassert>
+
+using namespace pdx;
+
+RangeAllocator::RangeAllocator(uint64_t capacity) : m_Capacity(capacity) {
+  if (capacity > 0) {
+    m_Free.emplace(0, capacity);
+  }
+}
+
+auto RangeAllocator::Allocate(uint64_t size) -> std::optional<uint64_t> {
+  if (size == 0) {
+    return 0;
+  }
+  for (auto it = m_Free.begin(); it != m_Free.end(); ++it) {
+    if (it->second < size) {
+      continue;
+    }
+    uint64_t offset = it->first;
+    uint64_t remaining = it->second - size;
+    m_Free.erase(it);
+    if (remaining > 0) {
+      m_Free.emplace(offset + size, remaining);
+    }
+    m_Used += size;
+    return offset;
+  }
+  return {};
+}
+
+auto RangeAllocator::Free(uint64_t offset, uint64_t size) -> void {
+  if (size == 0) {
+    return;
+  }
+  assert(offset + size <= m_Capacity);
+  m_Used -= size;
+
+  auto next = m_Free.lower_bound(offset);
+  // merge with the free range right after
+  if (next != m_Free.end() && next->first == offset + size) {
+    size += next->second;
+    next = m_Free.erase(next);
+  }
+  // and the one right before
+  if (next != m_Free.begin()) {
+    auto prev = std::prev(next);
+    if (prev->first + prev->second == offset) {
+      prev->second += size;
+      return;
+    }
+  }
+  m_Free.emplace_hint(next, offset, size);
+}
+
+auto RangeAllocator::Grow(uint64_t capacity) -> void {
+  if (capacity <= m_Capacity) {
+    return;
+  }
+  // the new tail counts as allocated until Free merges it in
+  uint64_t old = m_Capacity;
+  m_Capacity = capacity;
+  m_Used += capacity - old;
+  Free(old, capacity - old);
+}
+
+auto RangeAllocator::Capacity() const -> uint64_t { return m_Capacity; }
+auto RangeAllocator::Used() const -> uint64_t { return m_Used; }
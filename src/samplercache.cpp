@@ -0,0 +1,60 @@
+#include "samplercache.hpp"
+#include "glextensions.hpp"
+#include "glstate.hpp"
+
+#include <algorithm>
+
+using namespace pdx;
+
+auto SamplerCache::Get() -> SamplerCache& {
+  static SamplerCache cache;
+  return cache;
+}
+
+auto SamplerCache::Acquire(const pdx::MeshTexture& texture) -> GLuint {
+  Key key{texture.minFilter, texture.magFilter, texture.wrapS, texture.wrapT};
+  auto it = m_Samplers.find(key);
+  if (it != m_Samplers.end()) {
+    return it->second;
+  }
+
+  GLuint sampler;
+  glGenSamplers(1, &sampler);
+  glSamplerParameteri(sampler, GL_TEXTURE_MIN_FILTER, texture.minFilter);
+  glSamplerParameteri(sampler, GL_TEXTURE_MAG_FILTER, texture.magFilter);
+  glSamplerParameteri(sampler, GL_TEXTURE_WRAP_S, texture.wrapS);
+  glSamplerParameteri(sampler, GL_TEXTURE_WRAP_T, texture.wrapT);
+  Apply(sampler, texture.minFilter);
+  m_Samplers.emplace(key, sampler);
+  return sampler;
+}
+
+auto SamplerCache::Apply(GLuint sampler, GLint minFilter) const -> void {
+  const GLExtensions& extensions = GLExtensions::Get();
+  // anisotropy only makes a difference when sampling from a mip chain
+  if (extensions.maxAnisotropy > 0.0f && minFilter != GL_NEAREST &&
+      minFilter != GL_LINEAR) {
+    glSamplerParameterf(sampler, GL_TEXTURE_MAX_ANISOTROPY,
+                        std::clamp(m_Anisotropy, 1.0f,
+                                   extensions.maxAnisotropy));
+  }
+}
+
+auto SamplerCache::SetAnisotropy(float anisotropy) -> void {
+  m_Anisotropy = anisotropy;
+  for (const auto& [key, sampler] : m_Samplers) {
+    Apply(sampler, std::get<0>(key));
+  }
+}
+
+auto SamplerCache::Anisotropy() const -> float {
+  float max = GLExtensions::Get().maxAnisotropy;
+  return max > 0.0f ? std::clamp(m_Anisotropy, 1.0f, max) : 1.0f;
+}
+
+auto SamplerCache::Clear() -> void {
+  for (const auto& [key, sampler] : m_Samplers) {
+    GLState::Get().DeleteSampler(sampler);
+  }
+  m_Samplers.clear();
+}
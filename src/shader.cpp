@@ -10,8 +10,12 @@
 #include <fstream>
 #include <iostream>
 #include <sstream>
+#include <utility>
 
 #include "assetdir.hpp"
+#include "glextensions.hpp"
+#include "glstate.hpp"
+#include "programcache.hpp"
 #include "shader.hpp"
 #include "types.hpp"
 
@@ -19,7 +23,37 @@ using namespace pdx;
 
 static const AssetDir SHADER_DIR{"data", "shaders"};
 
-Shader::Shader(const std::string& vertFile, const std::string& fragFile) {
+// Inserts a #define line for each entry directly after the #version directive,
+// which has to stay the first line of the source
+static auto InjectDefines(const std::string& code,
+                          const std::vector<std::string>& defines)
+    -> std::string {
+  if (defines.empty()) {
+    return code;
+  }
+  std::string header;
+  for (const auto& define : defines) {
+    header += "#define " + define + "\n";
+  }
+  size_t pos = 0;
+  if (code.compare(0, 8, "#version") == 0) {
+    pos = code.find('\n');
+    pos = pos == std::string::npos ? code.size() : pos + 1;
+  }
+  std::string result = code;
+  result.insert(pos, header);
+  return result;
+}
+
+static auto ElapsedMs(uint64_t start) -> double {
+  return (double)(SDL_GetPerformanceCounter() - start) * 1000.0 /
+         (double)SDL_GetPerformanceFrequency();
+}
+
+Shader::Shader(const std::string& vertFile, const std::string& fragFile,
+               const std::vector<std::string>& defines,
+               pdx::ProgramCache *binaries)
+    : m_Name(vertFile + " " + fragFile), m_Binaries(binaries) {
   auto vFile = SHADER_DIR.GetFile(vertFile.c_str());
   auto fFile = SHADER_DIR.GetFile(fragFile.c_str());
   std::string vertexCode;
@@ -34,99 +68,330 @@ Shader::Shader(const std::string& vertFile, const std::string& fragFile) {
     std::stringstream vertSS, fragSS;
     vertSS << vertfs.rdbuf();
     fragSS << fragfs.rdbuf();
-    vertexCode = vertSS.str();
-    fragCode = fragSS.str();
+    vertexCode = InjectDefines(vertSS.str(), defines);
+    fragCode = InjectDefines(fragSS.str(), defines);
   } catch (std::ifstream::failure e) {
     std::cout << "Failed to read file" << std::endl;
   }
+
+  m_SubmitTime = SDL_GetPerformanceCounter();
+  if (m_Binaries != nullptr) {
+    m_SourceHash = ProgramCache::HashSources(vertexCode, fragCode);
+    m_Program = glCreateProgram();
+    if (m_Binaries->Load(m_SourceHash, m_Program)) {
+      std::cout << "Shader cache hit: " << m_Name << " ("
+                << ElapsedMs(m_SubmitTime) << " ms)" << std::endl;
+      m_Linked = true;
+      m_FromBinary = true;
+      ReflectUniforms();
+      return;
+    }
+    // a failed glProgramBinary leaves the program unusable, start over
+    glDeleteProgram(m_Program);
+    m_Program = 0;
+  }
+
+  Submit(vertexCode, fragCode);
+}
+
+auto Shader::FromSource(const std::string& vertCode,
+                        const std::string& fragCode) -> Shader {
+  Shader shader;
+  shader.m_Name = "<inline>";
+  shader.m_SubmitTime = SDL_GetPerformanceCounter();
+  shader.Submit(vertCode, fragCode);
+  shader.Finish();
+  return shader;
+}
+
+auto Shader::Submit(const std::string& vertexCode, const std::string& fragCode)
+    -> void {
   const char *vcode = vertexCode.c_str();
   const char *fcode = fragCode.c_str();
 
-  pdx::shader_t vert = glCreateShader(GL_VERTEX_SHADER);
-  glShaderSource(vert, 1, &vcode, nullptr);
-  glCompileShader(vert);
+  // nothing in here queries status, so a driver with parallel compile support
+  // can work on every submitted program at once
+  m_Vert = glCreateShader(GL_VERTEX_SHADER);
+  glShaderSource(m_Vert, 1, &vcode, nullptr);
+  glCompileShader(m_Vert);
+
+  m_Frag = glCreateShader(GL_FRAGMENT_SHADER);
+  glShaderSource(m_Frag, 1, &fcode, nullptr);
+  glCompileShader(m_Frag);
+
+  m_Program = glCreateProgram();
+  if (m_Binaries != nullptr) {
+    glProgramParameteri(m_Program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+  }
+  glAttachShader(m_Program, m_Vert);
+  glAttachShader(m_Program, m_Frag);
+  glLinkProgram(m_Program);
+  m_Pending = true;
+}
+
+auto Shader::Poll(bool parallelCompile) -> bool {
+  if (!m_Pending) {
+    return true;
+  }
+  if (parallelCompile) {
+    int done = GL_FALSE;
+    glGetProgramiv(m_Program, GL_COMPLETION_STATUS_KHR, &done);
+    if (!done) {
+      return false;
+    }
+  }
+  Finish();
+  return true;
+}
+
+auto Shader::Finish() -> void {
   // check for shader compile errors
   {
     int success;
     char infoLog[512];
-    glGetShaderiv(vert, GL_COMPILE_STATUS, &success);
+    glGetShaderiv(m_Vert, GL_COMPILE_STATUS, &success);
     if (!success) {
-      glGetShaderInfoLog(vert, 512, NULL, infoLog);
+      glGetShaderInfoLog(m_Vert, 512, NULL, infoLog);
       std::cout << "ERROR::SHADER::VERTEX::COMPILATION_FAILED\n"
                 << infoLog << std::endl;
     }
   }
-  pdx::shader_t frag = glCreateShader(GL_FRAGMENT_SHADER);
-
-  glShaderSource(frag, 1, &fcode, nullptr);
-  glCompileShader(frag);
   // check for shader compile errors
   {
     int success;
     char infoLog[512];
-    glGetShaderiv(frag, GL_COMPILE_STATUS, &success);
+    glGetShaderiv(m_Frag, GL_COMPILE_STATUS, &success);
     if (!success) {
-      glGetShaderInfoLog(frag, 512, NULL, infoLog);
+      glGetShaderInfoLog(m_Frag, 512, NULL, infoLog);
       std::cout << "ERROR::SHADER::FRAG::COMPILATION_FAILED\n"
                 << infoLog << std::endl;
     }
   }
+  // check for program link errors
+  {
+    int success;
+    char infoLog[512];
+    glGetProgramiv(m_Program, GL_LINK_STATUS, &success);
+    if (!success) {
+      glGetProgramInfoLog(m_Program, 512, NULL, infoLog);
+      std::cout << "ERROR::SHADER::PROGRAM::LINKING_FAILED\n"
+                << infoLog << std::endl;
+    }
+    m_Linked = success != 0;
+  }
 
-  m_Program = glCreateProgram();
-  glAttachShader(m_Program, vert);
-  glAttachShader(m_Program, frag);
-  glLinkProgram(m_Program);
-  glDeleteShader(vert);
-  glDeleteShader(frag);
+  glDetachShader(m_Program, m_Vert);
+  glDetachShader(m_Program, m_Frag);
+  glDeleteShader(m_Vert);
+  glDeleteShader(m_Frag);
+  m_Vert = 0;
+  m_Frag = 0;
+  m_Pending = false;
+
+  if (m_Binaries != nullptr && m_Linked) {
+    m_Binaries->Store(m_SourceHash, m_Program);
+    std::cout << "Shader cache miss: " << m_Name << " ("
+              << ElapsedMs(m_SubmitTime) << " ms)" << std::endl;
+  }
+
+  ReflectUniforms();
 }
 
-auto Shader::Use() const -> void { glUseProgram(m_Program); }
+auto Shader::IsReady() const -> bool { return !m_Pending; }
+
+auto Shader::IsLinked() const -> bool { return m_Linked; }
+
+auto Shader::FromBinary() const -> bool { return m_FromBinary; }
+
+Shader::Shader(Shader&& other) noexcept
+    : m_Program(std::exchange(other.m_Program, 0)),
+      m_Vert(std::exchange(other.m_Vert, 0)),
+      m_Frag(std::exchange(other.m_Frag, 0)),
+      m_Pending(std::exchange(other.m_Pending, false)),
+      m_Linked(std::exchange(other.m_Linked, false)),
+      m_FromBinary(other.m_FromBinary),
+      m_Name(std::move(other.m_Name)), m_SourceHash(other.m_SourceHash),
+      m_SubmitTime(other.m_SubmitTime), m_Binaries(other.m_Binaries),
+      m_Uniforms(std::move(other.m_Uniforms)) {}
 
-auto Shader::Set1f(const std::string& name, float x) const -> void {
-  glUniform1f(glGetUniformLocation(m_Program, name.c_str()), x);
+Shader::~Shader() { Release(); }
+
+auto Shader::operator=(Shader&& other) noexcept -> Shader& {
+  if (this != &other) {
+    Release();
+    m_Program = std::exchange(other.m_Program, 0);
+    m_Vert = std::exchange(other.m_Vert, 0);
+    m_Frag = std::exchange(other.m_Frag, 0);
+    m_Pending = std::exchange(other.m_Pending, false);
+    m_Linked = std::exchange(other.m_Linked, false);
+    m_FromBinary = other.m_FromBinary;
+    m_Name = std::move(other.m_Name);
+    m_SourceHash = other.m_SourceHash;
+    m_SubmitTime = other.m_SubmitTime;
+    m_Binaries = other.m_Binaries;
+    m_Uniforms = std::move(other.m_Uniforms);
+  }
+  return *this;
 }
-auto Shader::Set2f(const std::string& name, float x, float y) const -> void {
-  glUniform2f(glGetUniformLocation(m_Program, name.c_str()), x, y);
+
+auto Shader::Release() -> void {
+  if (m_Vert != 0) {
+    glDeleteShader(m_Vert);
+    m_Vert = 0;
+  }
+  if (m_Frag != 0) {
+    glDeleteShader(m_Frag);
+    m_Frag = 0;
+  }
+  if (m_Program != 0) {
+    GLState::Get().DeleteProgram(m_Program);
+    m_Program = 0;
+  }
+}
+
+auto Shader::Use() const -> void { GLState::Get().UseProgram(m_Program); }
+
+auto Shader::Location(pdx::UniformId id) const -> pdx::uniform_t {
+  if (m_Uniforms.empty()) {
+    return -1;
+  }
+  size_t mask = m_Uniforms.size() - 1;
+  for (size_t i = id.hash & mask;; i = (i + 1) & mask) {
+    const UniformSlot& slot = m_Uniforms[i];
+    if (slot.location == -1 || slot.hash == id.hash) {
+      return slot.location;
+    }
+  }
 }
-auto Shader::Set3f(const std::string& name, float x, float y, float z) const
+
+auto Shader::ReflectUniforms() -> void {
+  int count = 0;
+  int maxLength = 0;
+  glGetProgramiv(m_Program, GL_ACTIVE_UNIFORMS, &count);
+  glGetProgramiv(m_Program, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
+
+  // keep the load factor at or below one half so probes stay short
+  size_t capacity = 4;
+  while (capacity < static_cast<size_t>(count) * 2) {
+    capacity *= 2;
+  }
+  m_Uniforms.assign(capacity, UniformSlot{0, -1});
+  size_t mask = capacity - 1;
+
+  std::string name(maxLength, '\0');
+  for (int i = 0; i < count; ++i) {
+    GLsizei length = 0;
+    GLint size = 0;
+    GLenum type = 0;
+    glGetActiveUniform(m_Program, i, maxLength, &length, &size, &type,
+                       name.data());
+    pdx::uniform_t location = glGetUniformLocation(m_Program, name.c_str());
+    // members of uniform blocks have no location
+    if (location == -1) {
+      continue;
+    }
+
+    // arrays are reported as "name[0]", register them by their plain name
+    std::string_view key(name.data(), length);
+    if (key.ends_with("[0]")) {
+      key.remove_suffix(3);
+    }
+
+    uint32_t hash = HashName(key);
+    size_t slot = hash & mask;
+    while (m_Uniforms[slot].location != -1) {
+      if (m_Uniforms[slot].hash == hash) {
+        std::cout << "WARN: uniform hash collision: " << key << std::endl;
+        break;
+      }
+      slot = (slot + 1) & mask;
+    }
+    m_Uniforms[slot] = UniformSlot{hash, location};
+  }
+}
+
+auto Shader::Set1f(pdx::UniformId id, float x) const -> void {
+  Set1f(Location(id), x);
+}
+auto Shader::Set2f(pdx::UniformId id, float x, float y) const -> void {
+  Set2f(Location(id), x, y);
+}
+auto Shader::Set3f(pdx::UniformId id, float x, float y, float z) const
+    -> void {
+  Set3f(Location(id), x, y, z);
+}
+auto Shader::Set4f(pdx::UniformId id, float x, float y, float z, float w) const
+    -> void {
+  Set4f(Location(id), x, y, z, w);
+}
+auto Shader::Set1i(pdx::UniformId id, int x) const -> void {
+  Set1i(Location(id), x);
+}
+auto Shader::Set2i(pdx::UniformId id, int x, int y) const -> void {
+  Set2i(Location(id), x, y);
+}
+auto Shader::Set3i(pdx::UniformId id, int x, int y, int z) const -> void {
+  Set3i(Location(id), x, y, z);
+}
+auto Shader::Set4i(pdx::UniformId id, int x, int y, int z, int w) const
     -> void {
+  Set4i(Location(id), x, y, z, w);
+}
+auto Shader::SetMat4fv(pdx::UniformId id, const glm::mat4x4& value,
+                       bool transpose) const -> void {
+  SetMat4fv(Location(id), value, transpose);
+}
+auto Shader::Set2fv(pdx::UniformId id, const glm::vec2& value) const -> void {
+  Set2fv(Location(id), value);
+}
+auto Shader::Set3fv(pdx::UniformId id, const glm::vec3& value) const -> void {
+  Set3fv(Location(id), value);
+}
+auto Shader::Set4fv(pdx::UniformId id, const glm::vec4& value) const -> void {
+  Set4fv(Location(id), value);
+}
 
-  glUniform3f(glGetUniformLocation(m_Program, name.c_str()), x, y, z);
+auto Shader::Set1f(pdx::uniform_t location, float x) const -> void {
+  glUniform1f(location, x);
+}
+auto Shader::Set2f(pdx::uniform_t location, float x, float y) const -> void {
+  glUniform2f(location, x, y);
 }
-auto Shader::Set4f(const std::string& name, float x, float y, float z,
+auto Shader::Set3f(pdx::uniform_t location, float x, float y, float z) const
+    -> void {
+  glUniform3f(location, x, y, z);
+}
+auto Shader::Set4f(pdx::uniform_t location, float x, float y, float z,
                    float w) const -> void {
-  glUniform4f(glGetUniformLocation(m_Program, name.c_str()), x, y, z, w);
+  glUniform4f(location, x, y, z, w);
 }
-auto Shader::Set1i(const std::string& name, int x) const -> void {
-  glUniform1i(glGetUniformLocation(m_Program, name.c_str()), x);
+auto Shader::Set1i(pdx::uniform_t location, int x) const -> void {
+  glUniform1i(location, x);
 }
-auto Shader::Set2i(const std::string& name, int x, int y) const -> void {
-  glUniform2i(glGetUniformLocation(m_Program, name.c_str()), x, y);
+auto Shader::Set2i(pdx::uniform_t location, int x, int y) const -> void {
+  glUniform2i(location, x, y);
 }
-auto Shader::Set3i(const std::string& name, int x, int y, int z) const -> void {
-  glUniform3f(glGetUniformLocation(m_Program, name.c_str()), x, y, z);
+auto Shader::Set3i(pdx::uniform_t location, int x, int y, int z) const
+    -> void {
+  glUniform3i(location, x, y, z);
 }
-auto Shader::Set4i(const std::string& name, int x, int y, int z, int w) const
+auto Shader::Set4i(pdx::uniform_t location, int x, int y, int z, int w) const
     -> void {
-  glUniform4f(glGetUniformLocation(m_Program, name.c_str()), x, y, z, w);
+  glUniform4i(location, x, y, z, w);
 }
-auto Shader::SetMat4fv(const std::string& name, const glm::mat4x4& value,
+auto Shader::SetMat4fv(pdx::uniform_t location, const glm::mat4x4& value,
                        bool transpose) const -> void {
-  glUniformMatrix4fv(glGetUniformLocation(m_Program, name.c_str()), 1,
-                     transpose, glm::value_ptr(value));
+  glUniformMatrix4fv(location, 1, transpose, glm::value_ptr(value));
 }
-auto Shader::Set2fv(const std::string& name, const glm::vec2& value) const
+auto Shader::Set2fv(pdx::uniform_t location, const glm::vec2& value) const
     -> void {
-  glUniform2fv(glGetUniformLocation(m_Program, name.c_str()), 1,
-               glm::value_ptr(value));
+  glUniform2fv(location, 1, glm::value_ptr(value));
 }
-auto Shader::Set3fv(const std::string& name, const glm::vec3& value) const
+auto Shader::Set3fv(pdx::uniform_t location, const glm::vec3& value) const
     -> void {
-  glUniform3fv(glGetUniformLocation(m_Program, name.c_str()), 1,
-               glm::value_ptr(value));
+  glUniform3fv(location, 1, glm::value_ptr(value));
 }
-auto Shader::Set4fv(const std::string& name, const glm::vec4& value) const
+auto Shader::Set4fv(pdx::uniform_t location, const glm::vec4& value) const
     -> void {
-  glUniform4fv(glGetUniformLocation(m_Program, name.c_str()), 1,
-               glm::value_ptr(value));
+  glUniform4fv(location, 1, glm::value_ptr(value));
 }
@@ -0,0 +1,210 @@
+#include "shadercache.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <functional>
+#include <iostream>
+
+#include "glextensions.hpp"
+
+using namespace pdx;
+
+// the #version line and the defines are put in front by PlaceholderVert
+static const char *PLACEHOLDER_VERT = R"(
+layout(location = 0) in vec3 pos;
+
+layout(std140, binding = 0) uniform Camera {
+    mat4 view;
+    mat4 projection;
+    mat4 viewProj;
+    vec4 clipPlane;
+};
+
+#ifdef QUANTIZED
+layout(std140, binding = 2) uniform Mesh {
+    vec4 positionScale;
+    vec4 positionOffset;
+    vec4 texcoordTransform[2];
+};
+#endif
+
+uniform mat4 model;
+
+void main() {
+    vec3 position = pos;
+#ifdef QUANTIZED
+    position = position * positionScale.xyz + positionOffset.xyz;
+#endif
+    gl_Position = viewProj * model * vec4(position, 1.0);
+}
+)";
+
+static const char *PLACEHOLDER_FRAG = R"(#version 430 core
+out vec4 FragColor;
+
+void main() {
+    FragColor = vec4(0.5, 0.5, 0.5, 1.0);
+}
+)";
+
+// the placeholder has to read the same vertex format as the programs it
+// stands in for, QUANTIZED is the only define that changes it
+static auto IsQuantized(const std::vector<std::string>& defines) -> bool {
+  return std::find(defines.begin(), defines.end(), "QUANTIZED") !=
+         defines.end();
+}
+
+static auto PlaceholderVert(bool quantized) -> std::string {
+  return std::string("#version 430 core\n") +
+         (quantized ? "#define QUANTIZED\n" : "") + PLACEHOLDER_VERT;
+}
+
+auto ShaderCache::KeyHash::operator()(const Key& key) const -> size_t {
+  std::hash<std::string> hasher;
+  size_t hash = hasher(key.vertFile);
+  hash ^= hasher(key.fragFile) + 0x9e3779b9 + (hash << 6) + (hash >> 2);
+  for (const auto& define : key.defines) {
+    hash ^= hasher(define) + 0x9e3779b9 + (hash << 6) + (hash >> 2);
+  }
+  return hash;
+}
+
+ShaderCache::~ShaderCache() { Clear(); }
+
+auto ShaderCache::Init() -> void {
+  const GLExtensions& extensions = GLExtensions::Get();
+  m_ParallelCompile = extensions.parallelShaderCompile;
+  if (m_ParallelCompile) {
+    // let the driver pick as many compiler threads as it likes
+    extensions.MaxShaderCompilerThreads(0xFFFFFFFF);
+  }
+  for (bool quantized : {false, true}) {
+    m_Placeholders.push_back(
+        Shader::FromSource(PlaceholderVert(quantized), PLACEHOLDER_FRAG));
+  }
+}
+
+auto ShaderCache::Load(const std::string& vertFile, const std::string& fragFile,
+                       const std::vector<std::string>& defines)
+    -> pdx::shader_handle_t {
+  Key key{vertFile, fragFile, defines};
+  auto it = m_Handles.find(key);
+  if (it != m_Handles.end()) {
+    return it->second;
+  }
+
+  if (m_Placeholders.empty()) {
+    Init();
+  }
+
+  auto handle = static_cast<pdx::shader_handle_t>(m_Programs.size());
+  m_Programs.emplace_back(vertFile, fragFile, defines, &m_Binaries);
+  m_PlaceholderIndices.push_back(IsQuantized(defines) ? 1 : 0);
+  m_Keys.push_back(key);
+  m_Handles.emplace(std::move(key), handle);
+  // cache hits are counted by ProgramCache
+  if (!m_Programs.back().FromBinary()) {
+    ++m_FrameCompiles;
+    ++m_TotalCompiles;
+  }
+  return handle;
+}
+
+auto ShaderCache::Get(pdx::shader_handle_t handle) const
+    -> const pdx::Shader& {
+  assert(handle < m_Programs.size());
+  const pdx::Shader& program = m_Programs[handle];
+  if (!program.IsReady()) {
+    return m_Placeholders[m_PlaceholderIndices[handle]];
+  }
+  return program;
+}
+
+auto ShaderCache::IsReady(pdx::shader_handle_t handle) const -> bool {
+  assert(handle < m_Programs.size());
+  return m_Programs[handle].IsReady() && m_Programs[handle].IsLinked();
+}
+
+auto ShaderCache::Poll() -> void {
+  // without completion queries every check blocks, so only finish one
+  // program per frame and give the driver time with the rest
+  bool budget = true;
+  auto poll = [&](pdx::Shader& program) {
+    if (program.IsReady()) {
+      return true;
+    }
+    if (!m_ParallelCompile) {
+      if (!budget) {
+        return false;
+      }
+      budget = false;
+    }
+    return program.Poll(m_ParallelCompile);
+  };
+
+  for (auto& program : m_Programs) {
+    poll(program);
+  }
+
+  for (auto it = m_Reloads.begin(); it != m_Reloads.end();) {
+    if (!poll(it->program)) {
+      ++it;
+      continue;
+    }
+    if (it->program.IsLinked()) {
+      m_Programs[it->handle] = std::move(it->program);
+    } else {
+      const Key& key = m_Keys[it->handle];
+      std::cout << "Reload failed, keeping old program: " << key.vertFile
+                << " " << key.fragFile << std::endl;
+    }
+    it = m_Reloads.erase(it);
+  }
+}
+
+auto ShaderCache::Reload() -> void {
+  m_Reloads.clear();
+  for (size_t i = 0; i < m_Keys.size(); ++i) {
+    const Key& key = m_Keys[i];
+    m_Reloads.push_back(PendingReload{
+        static_cast<pdx::shader_handle_t>(i),
+        pdx::Shader(key.vertFile, key.fragFile, key.defines, &m_Binaries)});
+    if (!m_Reloads.back().program.FromBinary()) {
+      ++m_FrameCompiles;
+      ++m_TotalCompiles;
+    }
+  }
+}
+
+auto ShaderCache::Clear() -> void {
+  m_Reloads.clear();
+  m_Programs.clear();
+  m_Keys.clear();
+  m_Handles.clear();
+  m_PlaceholderIndices.clear();
+  m_Placeholders.clear();
+}
+
+auto ShaderCache::BeginFrame() -> void { m_FrameCompiles = 0; }
+
+auto ShaderCache::CompilesThisFrame() const -> uint32_t {
+  return m_FrameCompiles;
+}
+
+auto ShaderCache::TotalCompiles() const -> uint32_t { return m_TotalCompiles; }
+
+auto ShaderCache::Size() const -> size_t { return m_Programs.size(); }
+
+auto ShaderCache::Pending() const -> size_t {
+  size_t pending = m_Reloads.size();
+  for (const auto& program : m_Programs) {
+    if (!program.IsReady()) {
+      ++pending;
+    }
+  }
+  return pending;
+}
+
+auto ShaderCache::Binaries() const -> const pdx::ProgramCache& {
+  return m_Binaries;
+}
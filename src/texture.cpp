@@ -0,0 +1,157 @@
+#include "texture.hpp"
+#include "glextensions.hpp"
+#include "glstate.hpp"
+#include "ktx2.hpp"
+
+#include <iostream>
+
+using namespace pdx;
+
+Texture::Texture(GLuint id, size_t bytes) : m_Id(id), m_Bytes(bytes) {}
+
+Texture::~Texture() {
+  if (m_Id != 0) {
+    GLState::Get().DeleteTexture(m_Id);
+  }
+}
+
+auto Texture::Id() const -> GLuint { return m_Id; }
+auto Texture::Bytes() const -> size_t { return m_Bytes; }
+
+struct Format {
+  GLenum internal;
+  GLenum format;
+  GLenum type;
+  // per pixel, or per 4x4 block when compressed
+  uint32_t bytes;
+  bool compressed;
+};
+
+// the smallest internal format that holds the image, color data is stored as
+// sRGB so filtering and blending happen on linear values
+static auto ChooseFormat(const pdx::MeshTexture& texture) -> Format {
+  switch (texture.vkFormat) {
+  case Ktx2::R8_UNORM:
+    return {GL_R8, GL_RED, GL_UNSIGNED_BYTE, 1, false};
+  case Ktx2::R8G8_UNORM:
+    return {GL_RG8, GL_RG, GL_UNSIGNED_BYTE, 2, false};
+  case Ktx2::R8G8B8A8_UNORM:
+    return {GL_RGBA8, GL_RGBA, GL_UNSIGNED_BYTE, 4, false};
+  case Ktx2::R8G8B8A8_SRGB:
+    return {GL_SRGB8_ALPHA8, GL_RGBA, GL_UNSIGNED_BYTE, 4, false};
+  case Ktx2::BC1_RGBA_UNORM:
+    return {GL_COMPRESSED_RGBA_S3TC_DXT1_EXT, 0, 0, 8, true};
+  case Ktx2::BC1_RGBA_SRGB:
+    return {GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT1_EXT, 0, 0, 8, true};
+  case Ktx2::BC3_UNORM:
+    return {GL_COMPRESSED_RGBA_S3TC_DXT5_EXT, 0, 0, 16, true};
+  case Ktx2::BC3_SRGB:
+    return {GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT, 0, 0, 16, true};
+  case Ktx2::BC4_UNORM:
+    return {GL_COMPRESSED_RED_RGTC1, 0, 0, 8, true};
+  case Ktx2::BC5_UNORM:
+    return {GL_COMPRESSED_RG_RGTC2, 0, 0, 16, true};
+  default:
+    break;
+  }
+
+  bool wide = texture.bits == 16;
+  GLenum type = wide ? GL_UNSIGNED_SHORT : GL_UNSIGNED_BYTE;
+  uint32_t size = wide ? 2 : 1;
+  switch (texture.components) {
+  case 1:
+    return {wide ? (GLenum)GL_R16 : (GLenum)GL_R8, GL_RED, type, size, false};
+  case 2:
+    return {wide ? (GLenum)GL_RG16 : (GLenum)GL_RG8, GL_RG, type, 2 * size,
+            false};
+  case 3:
+    if (wide) {
+      return {GL_RGB16, GL_RGB, type, 6, false};
+    }
+    // three byte texels are padded by most drivers, it is no bigger as RGBA
+    return {texture.srgb ? (GLenum)GL_SRGB8_ALPHA8 : (GLenum)GL_RGBA8, GL_RGB,
+            type, 4, false};
+  default:
+    if (wide) {
+      return {GL_RGBA16, GL_RGBA, type, 8, false};
+    }
+    return {texture.srgb ? (GLenum)GL_SRGB8_ALPHA8 : (GLenum)GL_RGBA8,
+            GL_RGBA, type, 4, false};
+  }
+}
+
+auto pdx::CreateTexture(const pdx::MeshTexture& texture, const void *pixels)
+    -> GLuint {
+  if (texture.width <= 0 || texture.height <= 0) {
+    return 0;
+  }
+  Format format = ChooseFormat(texture);
+  // RGTC is core, the S3TC formats need extensions and there is no decoder
+  // to fall back to
+  const GLExtensions& extensions = GLExtensions::Get();
+  bool srgb = format.internal == GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT1_EXT ||
+              format.internal == GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT;
+  bool s3tc = srgb || format.internal == GL_COMPRESSED_RGBA_S3TC_DXT1_EXT ||
+              format.internal == GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+  if ((s3tc && !extensions.textureCompressionS3tc) ||
+      (srgb && !extensions.textureCompressionS3tcSrgb)) {
+    std::cout << (srgb ? "sRGB S3TC" : "S3TC")
+              << " textures are not supported: " << texture.uri << std::endl;
+    return 0;
+  }
+
+  // pre-built chains bring their own levels, everything else gets a full one
+  bool prebuilt = !texture.mips.empty();
+  int32_t levels = prebuilt ? (int32_t)texture.mips.size()
+                            : Ktx2::MipLevels(texture.width, texture.height);
+  const uint8_t *base = static_cast<const uint8_t *>(pixels);
+
+  GLuint texid;
+  glGenTextures(1, &texid);
+  GLState::Get().BindTexture(0, GL_TEXTURE_2D, texid);
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+  glTexStorage2D(GL_TEXTURE_2D, levels, format.internal, texture.width,
+                 texture.height);
+  // sampling state lives in sampler objects, this only covers the level range
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, levels - 1);
+
+  if (prebuilt) {
+    for (int32_t level = 0; level < levels; ++level) {
+      const pdx::MeshMip& mip = texture.mips[level];
+      if (format.compressed) {
+        glCompressedTexSubImage2D(GL_TEXTURE_2D, level, 0, 0, mip.width,
+                                  mip.height, format.internal,
+                                  (GLsizei)mip.size, base + mip.offset);
+      } else {
+        glTexSubImage2D(GL_TEXTURE_2D, level, 0, 0, mip.width, mip.height,
+                        format.format, format.type, base + mip.offset);
+      }
+    }
+  } else {
+    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, texture.width, texture.height,
+                    format.format, format.type, pixels);
+    if (levels > 1) {
+      glGenerateMipmap(GL_TEXTURE_2D);
+    }
+  }
+  return texid;
+}
+
+auto pdx::TextureBytes(const pdx::MeshTexture& texture) -> size_t {
+  if (texture.width <= 0 || texture.height <= 0) {
+    return 0;
+  }
+  Format format = ChooseFormat(texture);
+  if (!texture.mips.empty()) {
+    size_t bytes = 0;
+    for (const auto& mip : texture.mips) {
+      bytes += format.compressed
+                   ? mip.size
+                   : (size_t)mip.width * mip.height * format.bytes;
+    }
+    return bytes;
+  }
+  // a full mip chain adds a third
+  size_t bytes = (size_t)texture.width * texture.height * format.bytes;
+  return bytes + bytes / 3;
+}
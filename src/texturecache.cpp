@@ -0,0 +1,109 @@
+#include "texturecache.hpp"
+#include "glstate.hpp"
+
+#include <iomanip>
+#include <sstream>
+
+using namespace pdx;
+
+auto TextureCache::Get() -> TextureCache& {
+  static TextureCache cache;
+  return cache;
+}
+
+auto TextureCache::KeyHash::operator()(const TextureKey& key) const
+    -> size_t {
+  size_t hash = std::hash<std::string>()(key.source);
+  return hash ^ (key.srgb ? 0x9e3779b9 : 0);
+}
+
+auto TextureCache::KeyFor(const pdx::MeshTexture& texture,
+                          const std::filesystem::path& baseDir)
+    -> TextureKey {
+  TextureKey key{"", texture.srgb};
+  if (!texture.uri.empty() && texture.pixels.empty()) {
+    key.source = std::filesystem::absolute(baseDir / texture.uri)
+                     .lexically_normal()
+                     .string();
+    return key;
+  }
+  // 64 bit FNV-1a
+  uint64_t hash = 0xcbf29ce484222325ull;
+  for (uint8_t byte : texture.pixels) {
+    hash ^= byte;
+    hash *= 0x100000001b3ull;
+  }
+  std::ostringstream source;
+  source << "#" << std::hex << std::setw(16) << std::setfill('0') << hash
+         << "-" << std::dec << texture.width << "x" << texture.height << "x"
+         << texture.components;
+  key.source = source.str();
+  return key;
+}
+
+auto TextureCache::Find(const TextureKey& key)
+    -> std::shared_ptr<pdx::Texture> {
+  std::lock_guard<std::mutex> lock(m_Mutex);
+  auto it = m_Textures.find(key);
+  if (it == m_Textures.end()) {
+    return nullptr;
+  }
+  std::shared_ptr<pdx::Texture> texture = it->second.texture.lock();
+  if (texture != nullptr) {
+    ++m_Hits;
+  }
+  return texture;
+}
+
+auto TextureCache::Insert(const TextureKey& key, GLuint id, size_t bytes)
+    -> std::shared_ptr<pdx::Texture> {
+  std::lock_guard<std::mutex> lock(m_Mutex);
+  Entry& entry = m_Textures[key];
+  if (std::shared_ptr<pdx::Texture> existing = entry.texture.lock()) {
+    GLState::Get().DeleteTexture(id);
+    ++m_Hits;
+    return existing;
+  }
+
+  std::shared_ptr<pdx::Texture> texture(
+      new pdx::Texture(id, bytes),
+      [this, key](pdx::Texture *texture) { Remove(key, texture); });
+  entry = Entry{texture, texture.get()};
+  m_Bytes += bytes;
+  ++m_Uploads;
+  return texture;
+}
+
+auto TextureCache::Remove(const TextureKey& key, pdx::Texture *texture)
+    -> void {
+  {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    auto it = m_Textures.find(key);
+    if (it != m_Textures.end() && it->second.owner == texture) {
+      m_Textures.erase(it);
+    }
+    m_Bytes -= texture->Bytes();
+  }
+  // the last reference is always dropped on the render thread
+  delete texture;
+}
+
+auto TextureCache::Size() const -> size_t {
+  std::lock_guard<std::mutex> lock(m_Mutex);
+  return m_Textures.size();
+}
+
+auto TextureCache::Bytes() const -> size_t {
+  std::lock_guard<std::mutex> lock(m_Mutex);
+  return m_Bytes;
+}
+
+auto TextureCache::Hits() const -> uint32_t {
+  std::lock_guard<std::mutex> lock(m_Mutex);
+  return m_Hits;
+}
+
+auto TextureCache::Uploads() const -> uint32_t {
+  std::lock_guard<std::mutex> lock(m_Mutex);
+  return m_Uploads;
+}
@@ -0,0 +1,169 @@
+#include "bcn.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+using namespace pdx;
+
+// gathers the 4x4 block at (bx, by), clamping at the image edge
+static auto FetchBlock(const uint8_t *pixels, int width, int height,
+                       int channels, int bx, int by, uint8_t block[16][4])
+    -> void {
+  for (int y = 0; y < 4; ++y) {
+    for (int x = 0; x < 4; ++x) {
+      int sx = std::min(bx * 4 + x, width - 1);
+      int sy = std::min(by * 4 + y, height - 1);
+      const uint8_t *p = pixels + ((size_t)sy * width + sx) * channels;
+      uint8_t *out = block[y * 4 + x];
+      out[0] = p[0];
+      out[1] = channels > 1 ? p[1] : p[0];
+      out[2] = channels > 2 ? p[2] : p[0];
+      out[3] = channels > 3 ? p[3] : 255;
+    }
+  }
+}
+
+static auto To565(int r, int g, int b) -> uint16_t {
+  return (uint16_t)(((r * 31 + 127) / 255) << 11 | ((g * 63 + 127) / 255) << 5 |
+                    ((b * 31 + 127) / 255));
+}
+
+static auto From565(uint16_t c, int rgb[3]) -> void {
+  int r = (c >> 11) & 31, g = (c >> 5) & 63, b = c & 31;
+  rgb[0] = (r << 3) | (r >> 2);
+  rgb[1] = (g << 2) | (g >> 4);
+  rgb[2] = (b << 3) | (b >> 2);
+}
+
+static auto EncodeColorBlock(const uint8_t block[16][4], uint8_t *out)
+    -> void {
+  int lo[3] = {255, 255, 255}, hi[3] = {0, 0, 0};
+  for (int i = 0; i < 16; ++i) {
+    for (int c = 0; c < 3; ++c) {
+      lo[c] = std::min<int>(lo[c], block[i][c]);
+      hi[c] = std::max<int>(hi[c], block[i][c]);
+    }
+  }
+  // pull the end points in a little, the box corners are rarely hit
+  for (int c = 0; c < 3; ++c) {
+    int inset = (hi[c] - lo[c]) / 16;
+    lo[c] += inset;
+    hi[c] -= inset;
+  }
+
+  uint16_t c0 = To565(hi[0], hi[1], hi[2]);
+  uint16_t c1 = To565(lo[0], lo[1], lo[2]);
+  uint32_t indices = 0;
+  if (c0 < c1) {
+    std::swap(c0, c1);
+  }
+  if (c0 != c1) {
+    int palette[4][3];
+    From565(c0, palette[0]);
+    From565(c1, palette[1]);
+    for (int c = 0; c < 3; ++c) {
+      palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+      palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+    }
+    for (int i = 0; i < 16; ++i) {
+      int best = 0, bestError = 1 << 30;
+      for (int p = 0; p < 4; ++p) {
+        int error = 0;
+        for (int c = 0; c < 3; ++c) {
+          int d = block[i][c] - palette[p][c];
+          error += d * d;
+        }
+        if (error < bestError) {
+          best = p;
+          bestError = error;
+        }
+      }
+      indices |= (uint32_t)best << (i * 2);
+    }
+  }
+  memcpy(out, &c0, 2);
+  memcpy(out + 2, &c1, 2);
+  memcpy(out + 4, &indices, 4);
+}
+
+static auto EncodeAlphaBlock(const uint8_t block[16][4], int channel,
+                             uint8_t *out) -> void {
+  int lo = 255, hi = 0;
+  for (int i = 0; i < 16; ++i) {
+    lo = std::min<int>(lo, block[i][channel]);
+    hi = std::max<int>(hi, block[i][channel]);
+  }
+  out[0] = (uint8_t)hi;
+  out[1] = (uint8_t)lo;
+  uint64_t indices = 0;
+  if (hi != lo) {
+    // eight value mode, index 0 is hi, 1 is lo, 2..7 interpolate
+    int palette[8] = {hi, lo};
+    for (int p = 1; p < 7; ++p) {
+      palette[p + 1] = ((7 - p) * hi + p * lo) / 7;
+    }
+    for (int i = 0; i < 16; ++i) {
+      int best = 0, bestError = 1 << 30;
+      for (int p = 0; p < 8; ++p) {
+        int error = std::abs(block[i][channel] - palette[p]);
+        if (error < bestError) {
+          best = p;
+          bestError = error;
+        }
+      }
+      indices |= (uint64_t)best << (i * 3);
+    }
+  }
+  for (int i = 0; i < 6; ++i) {
+    out[2 + i] = (uint8_t)(indices >> (i * 8));
+  }
+}
+
+template <size_t BlockBytes, typename Encode>
+static auto EncodeImage(const uint8_t *pixels, int width, int height,
+                        int channels, Encode&& encode) -> std::vector<uint8_t> {
+  int blocksX = (width + 3) / 4, blocksY = (height + 3) / 4;
+  std::vector<uint8_t> result((size_t)blocksX * blocksY * BlockBytes);
+  uint8_t block[16][4];
+  for (int by = 0; by < blocksY; ++by) {
+    for (int bx = 0; bx < blocksX; ++bx) {
+      FetchBlock(pixels, width, height, channels, bx, by, block);
+      encode(block, result.data() + ((size_t)by * blocksX + bx) * BlockBytes);
+    }
+  }
+  return result;
+}
+
+auto Bcn::EncodeBC1(const uint8_t *pixels, int width, int height,
+                    int channels) -> std::vector<uint8_t> {
+  return EncodeImage<8>(pixels, width, height, channels,
+                        [](const uint8_t block[16][4], uint8_t *out) {
+                          EncodeColorBlock(block, out);
+                        });
+}
+
+auto Bcn::EncodeBC3(const uint8_t *pixels, int width, int height,
+                    int channels) -> std::vector<uint8_t> {
+  return EncodeImage<16>(pixels, width, height, channels,
+                         [](const uint8_t block[16][4], uint8_t *out) {
+                           EncodeAlphaBlock(block, 3, out);
+                           EncodeColorBlock(block, out + 8);
+                         });
+}
+
+auto Bcn::EncodeBC4(const uint8_t *pixels, int width, int height,
+                    int channels) -> std::vector<uint8_t> {
+  return EncodeImage<8>(pixels, width, height, channels,
+                        [](const uint8_t block[16][4], uint8_t *out) {
+                          EncodeAlphaBlock(block, 0, out);
+                        });
+}
+
+auto Bcn::EncodeBC5(const uint8_t *pixels, int width, int height,
+                    int channels) -> std::vector<uint8_t> {
+  return EncodeImage<16>(pixels, width, height, channels,
+                         [](const uint8_t block[16][4], uint8_t *out) {
+                           EncodeAlphaBlock(block, 0, out);
+                           EncodeAlphaBlock(block, 1, out + 8);
+                         });
+}
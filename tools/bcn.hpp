@@ -0,0 +1,28 @@
+#ifndef __HPP_PARADOX_BCN__
+#define __HPP_PARADOX_BCN__
+
+#include <cstdint>
+#include <vector>
+
+namespace pdx {
+// Straightforward bounding box BCn encoders for the cooker. Quality is
+// below a dedicated compressor but they are fast and dependency free.
+// Input is tightly packed 8 bit pixels with the given channel count, the
+// result is the compressed level ready for upload
+namespace Bcn {
+// RGB(A) to BC1, alpha is ignored
+auto EncodeBC1(const uint8_t *pixels, int width, int height, int channels)
+    -> std::vector<uint8_t>;
+// RGBA to BC3
+auto EncodeBC3(const uint8_t *pixels, int width, int height, int channels)
+    -> std::vector<uint8_t>;
+// first channel to BC4
+auto EncodeBC4(const uint8_t *pixels, int width, int height, int channels)
+    -> std::vector<uint8_t>;
+// first two channels to BC5
+auto EncodeBC5(const uint8_t *pixels, int width, int height, int channels)
+    -> std::vector<uint8_t>;
+} // namespace Bcn
+} // namespace pdx
+
+#endif /*  __HPP_PARADOX_BCN__ */
@@ -0,0 +1,261 @@
+// Offline cooker, converts a glTF scene into the .pdxmesh layout the game
+// maps at load time.
+//
+//   pdxcook <scene.gltf|scene.glb> [out.pdxmesh]
+//
+// Triangle lists are reordered for the vertex cache, overdraw and vertex
+// fetch, then simplified into a chain of LODs. Images are written as block
+// compressed KTX2 files with mip chains, next to the cooked file. Texture uris
+// are resolved against that directory.
+
+#include "bcn.hpp"
+#include "ktx2.hpp"
+#include "meshdata.hpp"
+#include "meshoptimize.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <filesystem>
+#include <iostream>
+#include <map>
+#include <string>
+#include <utility>
+
+#define TINYGLTF_IMPLEMENTATION
+#define STB_IMAGE_IMPLEMENTATION
+#define STB_IMAGE_WRITE_IMPLEMENTATION
+#define TINYGLTF_NOEXCEPTION
+#define JSON_NOEXCEPTION
+#include <tiny_gltf.h>
+
+using namespace pdx;
+
+// 8 bit copy of texture's pixels, 16 bit images keep their high byte
+static auto EightBit(const MeshTexture& texture) -> std::vector<uint8_t> {
+  if (texture.bits != 16) {
+    return texture.pixels;
+  }
+  std::vector<uint8_t> result(texture.pixels.size() / 2);
+  for (size_t i = 0; i < result.size(); ++i) {
+    result[i] = texture.pixels[i * 2 + 1];
+  }
+  return result;
+}
+
+static auto SrgbToLinear(uint8_t value) -> float {
+  float c = value / 255.0f;
+  return c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+}
+
+static auto LinearToSrgb(float c) -> uint8_t {
+  c = c <= 0.0031308f ? c * 12.92f : 1.055f * std::pow(c, 1 / 2.4f) - 0.055f;
+  return (uint8_t)std::clamp(c * 255.0f + 0.5f, 0.0f, 255.0f);
+}
+
+// 2x2 box filter, color channels of sRGB images are averaged in linear space
+static auto Downsample(const std::vector<uint8_t>& pixels, int width,
+                       int height, int channels, bool srgb)
+    -> std::vector<uint8_t> {
+  int w = std::max(width / 2, 1), h = std::max(height / 2, 1);
+  std::vector<uint8_t> result((size_t)w * h * channels);
+  for (int y = 0; y < h; ++y) {
+    for (int x = 0; x < w; ++x) {
+      for (int c = 0; c < channels; ++c) {
+        bool linear = srgb && c < 3;
+        float sum = 0.0f;
+        for (int i = 0; i < 4; ++i) {
+          int sx = std::min(x * 2 + (i & 1), width - 1);
+          int sy = std::min(y * 2 + (i >> 1), height - 1);
+          uint8_t v = pixels[((size_t)sy * width + sx) * channels + c];
+          sum += linear ? SrgbToLinear(v) : v;
+        }
+        result[((size_t)y * w + x) * channels + c] =
+            linear ? LinearToSrgb(sum / 4.0f)
+                   : (uint8_t)std::min(sum / 4.0f + 0.5f, 255.0f);
+      }
+    }
+  }
+  return result;
+}
+
+// picks the smallest block format that keeps the image's channels
+static auto ChooseFormat(const MeshTexture& texture,
+                         const std::vector<uint8_t>& pixels) -> uint32_t {
+  switch (texture.components) {
+  case 1:
+    return Ktx2::BC4_UNORM;
+  case 2:
+    return Ktx2::BC5_UNORM;
+  case 4:
+    for (size_t i = 3; i < pixels.size(); i += 4) {
+      if (pixels[i] != 255) {
+        return texture.srgb ? Ktx2::BC3_SRGB : Ktx2::BC3_UNORM;
+      }
+    }
+    [[fallthrough]];
+  default:
+    return texture.srgb ? Ktx2::BC1_RGBA_SRGB : Ktx2::BC1_RGBA_UNORM;
+  }
+}
+
+static auto Encode(uint32_t format, const std::vector<uint8_t>& pixels,
+                   int width, int height, int channels)
+    -> std::vector<uint8_t> {
+  switch (format) {
+  case Ktx2::BC4_UNORM:
+    return Bcn::EncodeBC4(pixels.data(), width, height, channels);
+  case Ktx2::BC5_UNORM:
+    return Bcn::EncodeBC5(pixels.data(), width, height, channels);
+  case Ktx2::BC3_UNORM:
+  case Ktx2::BC3_SRGB:
+    return Bcn::EncodeBC3(pixels.data(), width, height, channels);
+  default:
+    return Bcn::EncodeBC1(pixels.data(), width, height, channels);
+  }
+}
+
+// every image is written next to the cooked file as a block compressed KTX2
+// with a full mip chain, the runtime only knows how to load textures by uri
+static auto CookTextures(MeshData& mesh, const std::filesystem::path& output)
+    -> bool {
+  std::map<std::pair<std::string, bool>, std::string> cooked;
+  for (size_t i = 0; i < mesh.textures.size(); ++i) {
+    MeshTexture& texture = mesh.textures[i];
+    if (texture.pixels.empty()) {
+      continue;
+    }
+    auto key = std::make_pair(texture.uri, texture.srgb);
+    auto it = cooked.find(key);
+    if (!texture.uri.empty() && it != cooked.end()) {
+      texture.uri = it->second;
+      std::vector<uint8_t>().swap(texture.pixels);
+      continue;
+    }
+
+    std::filesystem::path uri =
+        texture.uri.empty()
+            ? std::filesystem::path(output.stem().string() + "_" +
+                                    std::to_string(i))
+            : std::filesystem::path(texture.uri);
+    uri.replace_extension(texture.srgb ? ".ktx2" : ".linear.ktx2");
+
+    std::vector<uint8_t> level = EightBit(texture);
+    int channels = texture.components;
+    MeshTexture image{};
+    image.vkFormat = ChooseFormat(texture, level);
+    image.width = texture.width;
+    image.height = texture.height;
+    int width = texture.width, height = texture.height;
+    while (true) {
+      std::vector<uint8_t> blocks =
+          Encode(image.vkFormat, level, width, height, channels);
+      image.mips.push_back(
+          MeshMip{width, height, image.pixels.size(), blocks.size()});
+      image.pixels.insert(image.pixels.end(), blocks.begin(), blocks.end());
+      if (width == 1 && height == 1) {
+        break;
+      }
+      level = Downsample(level, width, height, channels, texture.srgb);
+      width = std::max(width / 2, 1);
+      height = std::max(height / 2, 1);
+    }
+
+    std::filesystem::path file = output.parent_path() / uri;
+    std::error_code ec;
+    std::filesystem::create_directories(file.parent_path(), ec);
+    if (!Ktx2::Write(file, image)) {
+      std::cout << "Failed to write: " << file.string() << std::endl;
+      return false;
+    }
+    std::cout << file.string() << ": " << texture.width << "x"
+              << texture.height << ", " << image.mips.size() << " levels, "
+              << image.pixels.size() / 1024 << " KiB (was "
+              << (size_t)texture.width * texture.height * 4 * 4 / 3 / 1024
+              << " KiB as RGBA8)" << std::endl;
+
+    cooked[key] = uri.generic_string();
+    texture.uri = uri.generic_string();
+    // pixels are reloaded from the uri at runtime
+    std::vector<uint8_t>().swap(texture.pixels);
+  }
+  return true;
+}
+
+// external buffers and images of model, the files besides the glTF itself
+// a change to which makes the cooked mesh stale
+static auto SourceFiles(const tinygltf::Model& model)
+    -> std::vector<std::string> {
+  std::vector<std::string> files;
+  auto add = [&](const std::string& uri) {
+    if (!uri.empty() && uri.rfind("data:", 0) != 0 &&
+        std::find(files.begin(), files.end(), uri) == files.end()) {
+      files.push_back(uri);
+    }
+  };
+  for (const auto& buffer : model.buffers) {
+    add(buffer.uri);
+  }
+  for (const auto& image : model.images) {
+    add(image.uri);
+  }
+  return files;
+}
+
+auto main(int argc, char **argv) -> int {
+  if (argc < 2) {
+    std::cout << "usage: " << argv[0] << " <scene.gltf|scene.glb> [out]"
+              << std::endl;
+    return 1;
+  }
+  std::filesystem::path input(argv[1]);
+  std::filesystem::path output =
+      argc > 2 ? std::filesystem::path(argv[2])
+               : std::filesystem::path(input).replace_extension(".pdxmesh");
+
+  tinygltf::Model model;
+  tinygltf::TinyGLTF loader;
+  std::string err;
+  std::string warn;
+  bool res = input.extension() == ".glb"
+                 ? loader.LoadBinaryFromFile(&model, &err, &warn,
+                                             input.string())
+                 : loader.LoadASCIIFromFile(&model, &err, &warn,
+                                            input.string());
+  if (!warn.empty()) {
+    std::cout << "WARN: " << warn << std::endl;
+  }
+  if (!err.empty()) {
+    std::cout << "ERR: " << err << std::endl;
+  }
+  if (!res) {
+    std::cout << "Failed to load glTF: " << input.string() << std::endl;
+    return 1;
+  }
+
+  MeshData mesh = MeshData::FromGLTF(model);
+  MeshOptimize::Report report = MeshOptimize::Optimize(mesh);
+  std::cout << input.string() << ": ACMR " << report.before.acmr << " -> "
+            << report.after.acmr << ", ATVR " << report.before.atvr << " -> "
+            << report.after.atvr << ", overfetch " << report.before.overfetch
+            << " -> " << report.after.overfetch << " (" << report.packets
+            << " packets)" << std::endl;
+  size_t lods = MeshOptimize::BuildLods(mesh);
+  std::cout << input.string() << ": " << lods << " LOD levels" << std::endl;
+  if (!CookTextures(mesh, output)) {
+    return 1;
+  }
+  std::vector<std::string> sources = SourceFiles(model);
+  if (!MeshFile::Write(output, mesh.View(),
+                       MeshFile::HashSources(input, sources), sources)) {
+    std::cout << "Failed to write: " << output.string() << std::endl;
+    return 1;
+  }
+
+  std::error_code ec;
+  std::cout << output.string() << ": " << mesh.vertices.size()
+            << " vertices, " << mesh.indices.size() / 3 << " triangles, "
+            << mesh.packets.size() << " packets, "
+            << std::filesystem::file_size(output, ec) / 1024 << " KiB"
+            << std::endl;
+  return 0;
+}